@@ -0,0 +1,517 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Checkpoints are little-endian binary files laid out as follows:
+ *
+ *   header        magic, format version, chip name, package and chipdb checksum
+ *   string table  every IdString used in the rest of the file, which refers to them by index
+ *   names         the names of all cells and nets, so that the bodies below can refer to each other
+ *   cells         type, attributes, parameters, ports, bel binding, pins and placement constraints
+ *   nets          attributes, driver and users, clock constraint and bound wires and pips
+ *
+ * Bels, wires and pips are stored by location and index, which is why the chipdb checksum must match on load.
+ */
+
+#include "checkpoint.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include "log.h"
+#include "util.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+namespace {
+
+const char checkpoint_magic[8] = {'N', 'P', 'N', 'R', 'C', 'K', 'P', 'T'};
+const uint32_t checkpoint_version = 1;
+
+struct CheckpointWriter
+{
+    Context *ctx;
+    std::string body;
+    std::unordered_map<IdString, uint32_t> id_index;
+    std::vector<IdString> ids;
+
+    CheckpointWriter(Context *ctx) : ctx(ctx) {}
+
+    void u8(uint8_t v) { body.push_back(char(v)); }
+
+    void u32(uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            body.push_back(char((v >> (8 * i)) & 0xFF));
+    }
+
+    void i32(int32_t v) { u32(uint32_t(v)); }
+
+    void str(const std::string &s)
+    {
+        u32(uint32_t(s.size()));
+        body.append(s);
+    }
+
+    void id(IdString s)
+    {
+        auto fnd = id_index.find(s);
+        if (fnd == id_index.end()) {
+            fnd = id_index.emplace(s, uint32_t(ids.size())).first;
+            ids.push_back(s);
+        }
+        u32(fnd->second);
+    }
+
+    void loc(Location l)
+    {
+        i32(l.x);
+        i32(l.y);
+    }
+
+    void delay(const DelayInfo &d)
+    {
+        i32(d.min_delay);
+        i32(d.max_delay);
+    }
+
+    void attrs(const std::unordered_map<IdString, std::string> &a)
+    {
+        std::map<IdString, std::string> sorted_attrs(a.begin(), a.end());
+        u32(uint32_t(sorted_attrs.size()));
+        for (auto &it : sorted_attrs) {
+            id(it.first);
+            str(it.second);
+        }
+    }
+
+    void port_ref(const PortRef &ref)
+    {
+        id(ref.cell == nullptr ? IdString() : ref.cell->name);
+        id(ref.port);
+        i32(ref.budget);
+    }
+
+    void cell(const CellInfo *ci)
+    {
+        id(ci->type);
+        attrs(ci->attrs);
+        attrs(ci->params);
+
+        std::map<IdString, const PortInfo *> ports;
+        for (auto &it : ci->ports)
+            ports[it.first] = &it.second;
+        u32(uint32_t(ports.size()));
+        for (auto &it : ports) {
+            id(it.first);
+            u8(uint8_t(it.second->type));
+            id(it.second->net == nullptr ? IdString() : it.second->net->name);
+        }
+
+        loc(ci->bel.location);
+        i32(ci->bel.index);
+        u8(uint8_t(ci->belStrength));
+
+        std::map<IdString, IdString> pins(ci->pins.begin(), ci->pins.end());
+        u32(uint32_t(pins.size()));
+        for (auto &it : pins) {
+            id(it.first);
+            id(it.second);
+        }
+
+        id(ci->constr_parent == nullptr ? IdString() : ci->constr_parent->name);
+        i32(ci->constr_x);
+        i32(ci->constr_y);
+        i32(ci->constr_z);
+        u8(ci->constr_abs_z);
+    }
+
+    void net(const NetInfo *ni)
+    {
+        u8(ni->is_global);
+        attrs(ni->attrs);
+        port_ref(ni->driver);
+        u32(uint32_t(ni->users.size()));
+        for (auto &user : ni->users)
+            port_ref(user);
+
+        u8(ni->clkconstr != nullptr);
+        if (ni->clkconstr != nullptr) {
+            delay(ni->clkconstr->high);
+            delay(ni->clkconstr->low);
+            delay(ni->clkconstr->period);
+        }
+
+        // Wires bound directly come first so that loading can bind them before the pips driven by them
+        std::vector<std::pair<WireId, PipMap>> wires(ni->wires.begin(), ni->wires.end());
+        std::stable_partition(wires.begin(), wires.end(),
+                              [](const std::pair<WireId, PipMap> &w) { return w.second.pip == PipId(); });
+        u32(uint32_t(wires.size()));
+        for (auto &w : wires) {
+            bool has_pip = w.second.pip != PipId();
+            u8(has_pip);
+            u8(uint8_t(w.second.strength));
+            if (has_pip) {
+                loc(w.second.pip.location);
+                i32(w.second.pip.index);
+            } else {
+                loc(w.first.location);
+                i32(w.first.index);
+            }
+        }
+    }
+};
+
+struct CheckpointReader
+{
+    Context *ctx;
+    std::string filename;
+    std::string data;
+    size_t pos = 0;
+    std::vector<IdString> ids;
+
+    CheckpointReader(Context *ctx, const std::string &filename) : ctx(ctx), filename(filename) {}
+
+    void need(size_t n)
+    {
+        if (data.size() - pos < n)
+            log_error("Checkpoint file '%s' is truncated.\n", filename.c_str());
+    }
+
+    uint8_t u8()
+    {
+        need(1);
+        return uint8_t(data[pos++]);
+    }
+
+    uint32_t u32()
+    {
+        need(4);
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++)
+            v |= uint32_t(uint8_t(data[pos++])) << (8 * i);
+        return v;
+    }
+
+    int32_t i32() { return int32_t(u32()); }
+
+    std::string str()
+    {
+        uint32_t len = u32();
+        need(len);
+        std::string s = data.substr(pos, len);
+        pos += len;
+        return s;
+    }
+
+    IdString id()
+    {
+        uint32_t idx = u32();
+        if (idx >= ids.size())
+            log_error("Checkpoint file '%s' is corrupt.\n", filename.c_str());
+        return ids[idx];
+    }
+
+    Location loc()
+    {
+        Location l;
+        l.x = int16_t(i32());
+        l.y = int16_t(i32());
+        return l;
+    }
+
+    DelayInfo delay()
+    {
+        DelayInfo d;
+        d.min_delay = i32();
+        d.max_delay = i32();
+        return d;
+    }
+
+    void attrs(std::unordered_map<IdString, std::string> &a)
+    {
+        uint32_t count = u32();
+        for (uint32_t i = 0; i < count; i++) {
+            IdString key = id();
+            a[key] = str();
+        }
+    }
+
+    CellInfo *cell_ptr(IdString name)
+    {
+        if (name == IdString())
+            return nullptr;
+        auto fnd = ctx->cells.find(name);
+        if (fnd == ctx->cells.end())
+            log_error("Checkpoint file '%s' refers to unknown cell '%s'.\n", filename.c_str(), name.c_str(ctx));
+        return fnd->second.get();
+    }
+
+    NetInfo *net_ptr(IdString name)
+    {
+        if (name == IdString())
+            return nullptr;
+        auto fnd = ctx->nets.find(name);
+        if (fnd == ctx->nets.end())
+            log_error("Checkpoint file '%s' refers to unknown net '%s'.\n", filename.c_str(), name.c_str(ctx));
+        return fnd->second.get();
+    }
+
+    void port_ref(PortRef &ref)
+    {
+        ref.cell = cell_ptr(id());
+        ref.port = id();
+        ref.budget = i32();
+    }
+
+    void cell(CellInfo *ci)
+    {
+        ci->type = id();
+        attrs(ci->attrs);
+        attrs(ci->params);
+
+        uint32_t num_ports = u32();
+        for (uint32_t i = 0; i < num_ports; i++) {
+            IdString name = id();
+            PortInfo &port = ci->ports[name];
+            port.name = name;
+            port.type = PortType(u8());
+            port.net = net_ptr(id());
+        }
+
+        // Bound once all cells are loaded and assignArchInfo has run
+        ci->bel.location = loc();
+        ci->bel.index = i32();
+        ci->belStrength = PlaceStrength(u8());
+
+        uint32_t num_pins = u32();
+        for (uint32_t i = 0; i < num_pins; i++) {
+            IdString port = id();
+            ci->pins[port] = id();
+        }
+
+        ci->constr_parent = cell_ptr(id());
+        if (ci->constr_parent != nullptr)
+            ci->constr_parent->constr_children.push_back(ci);
+        ci->constr_x = i32();
+        ci->constr_y = i32();
+        ci->constr_z = i32();
+        ci->constr_abs_z = u8();
+    }
+
+    void net(NetInfo *ni, std::vector<std::pair<WireId, PlaceStrength>> &wires,
+             std::vector<std::pair<PipId, PlaceStrength>> &pips)
+    {
+        ni->is_global = u8();
+        attrs(ni->attrs);
+        port_ref(ni->driver);
+        ni->users.resize(u32());
+        for (auto &user : ni->users)
+            port_ref(user);
+
+        if (u8()) {
+            ni->clkconstr = std::unique_ptr<ClockConstraint>(new ClockConstraint());
+            ni->clkconstr->high = delay();
+            ni->clkconstr->low = delay();
+            ni->clkconstr->period = delay();
+        }
+
+        uint32_t num_wires = u32();
+        for (uint32_t i = 0; i < num_wires; i++) {
+            bool has_pip = u8();
+            PlaceStrength strength = PlaceStrength(u8());
+            Location l = loc();
+            int32_t index = i32();
+            if (has_pip) {
+                PipId pip;
+                pip.location = l;
+                pip.index = index;
+                pips.emplace_back(pip, strength);
+            } else {
+                WireId wire;
+                wire.location = l;
+                wire.index = index;
+                wires.emplace_back(wire, strength);
+            }
+        }
+    }
+};
+
+bool in_grid(const Context *ctx, Location loc)
+{
+    return loc.x >= 0 && loc.y >= 0 && loc.x < ctx->getGridDimX() && loc.y < ctx->getGridDimY();
+}
+
+} // namespace
+
+void save_checkpoint(Context *ctx, const std::string &filename)
+{
+    CheckpointWriter w(ctx);
+
+    auto cells = sorted(ctx->cells);
+    auto nets = sorted(ctx->nets);
+
+    w.u32(uint32_t(cells.size()));
+    for (auto &cell : cells)
+        w.id(cell.first);
+    w.u32(uint32_t(nets.size()));
+    for (auto &net : nets)
+        w.id(net.first);
+    for (auto &cell : cells)
+        w.cell(cell.second);
+    for (auto &net : nets)
+        w.net(net.second);
+
+    // The string table has to come first, but is only known once the rest has been written
+    std::string body;
+    body.swap(w.body);
+    w.str(ctx->getChipName());
+    w.str(ctx->archArgs().package);
+    w.u32(ctx->getChipdbChecksum());
+    w.u32(uint32_t(w.ids.size()));
+    for (auto id : w.ids)
+        w.str(id.str(ctx));
+
+    std::ofstream f(filename, std::ios::binary);
+    if (!f)
+        log_error("Failed to open checkpoint file '%s' for writing\n", filename.c_str());
+    f.write(checkpoint_magic, sizeof(checkpoint_magic));
+    uint32_t version = checkpoint_version;
+    for (int i = 0; i < 4; i++)
+        f.put(char((version >> (8 * i)) & 0xFF));
+    f.write(w.body.data(), w.body.size());
+    f.write(body.data(), body.size());
+    if (!f)
+        log_error("Failed to write checkpoint file '%s'\n", filename.c_str());
+
+    log_info("Wrote checkpoint with %d cells and %d nets to '%s'.\n", int(cells.size()), int(nets.size()),
+             filename.c_str());
+}
+
+void load_checkpoint(Context *ctx, const std::string &filename)
+{
+    if (!ctx->cells.empty() || !ctx->nets.empty())
+        log_error("A checkpoint can only be loaded into an empty design.\n");
+
+    std::ifstream f(filename, std::ios::binary);
+    if (!f)
+        log_error("Failed to open checkpoint file '%s' for reading\n", filename.c_str());
+
+    log_info("Loading checkpoint '%s'..\n", filename.c_str());
+
+    CheckpointReader r(ctx, filename);
+    r.data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+
+    r.need(sizeof(checkpoint_magic));
+    if (r.data.compare(0, sizeof(checkpoint_magic), checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+        log_error("'%s' is not a checkpoint file.\n", filename.c_str());
+    r.pos += sizeof(checkpoint_magic);
+    uint32_t version = r.u32();
+    if (version != checkpoint_version)
+        log_error("Checkpoint file '%s' has unsupported version %d.\n", filename.c_str(), int(version));
+
+    std::string chip = r.str(), package = r.str();
+    if (chip != ctx->getChipName() || package != ctx->archArgs().package)
+        log_error("Checkpoint file '%s' is for %s in package %s, not %s in package %s.\n", filename.c_str(),
+                  chip.c_str(), package.c_str(), ctx->getChipName().c_str(), ctx->archArgs().package.c_str());
+    if (r.u32() != ctx->getChipdbChecksum())
+        log_error("Checkpoint file '%s' was written with a different chip database.\n", filename.c_str());
+
+    uint32_t num_ids = r.u32();
+    for (uint32_t i = 0; i < num_ids; i++)
+        r.ids.push_back(ctx->id(r.str()));
+
+    std::vector<CellInfo *> cells(r.u32());
+    for (auto &ci : cells) {
+        std::unique_ptr<CellInfo> cell(new CellInfo());
+        cell->name = r.id();
+        ci = cell.get();
+        ctx->cells[cell->name] = std::move(cell);
+    }
+    std::vector<NetInfo *> nets(r.u32());
+    for (auto &ni : nets) {
+        std::unique_ptr<NetInfo> net(new NetInfo());
+        net->name = r.id();
+        ni = net.get();
+        ctx->nets[net->name] = std::move(net);
+    }
+
+    for (auto ci : cells)
+        r.cell(ci);
+
+    std::vector<std::pair<WireId, PlaceStrength>> wires;
+    std::vector<std::pair<PipId, PlaceStrength>> pips;
+    // End of the wires and pips of each net in the arrays above
+    std::vector<size_t> wires_end, pips_end;
+    for (auto ni : nets) {
+        r.net(ni, wires, pips);
+        wires_end.push_back(wires.size());
+        pips_end.push_back(pips.size());
+    }
+
+    if (r.pos != r.data.size())
+        log_error("Checkpoint file '%s' has trailing data.\n", filename.c_str());
+
+    ctx->assignArchInfo();
+
+    int bound_bels = 0;
+    for (auto ci : cells) {
+        if (ci->bel == BelId())
+            continue;
+        BelId bel = ci->bel;
+        PlaceStrength strength = ci->belStrength;
+        ci->bel = BelId();
+        if (!in_grid(ctx, bel.location) || bel.index < 0 || bel.index >= ctx->locInfo(bel)->num_bels)
+            log_error("Checkpoint file '%s' places cell '%s' at an invalid bel.\n", filename.c_str(), ctx->nameOf(ci));
+        if (!ctx->checkBelAvail(bel))
+            log_error("Checkpoint file '%s' places cell '%s' at bel %s, which is already used.\n", filename.c_str(),
+                      ctx->nameOf(ci), ctx->nameOfBel(bel));
+        ctx->bindBel(bel, ci, strength);
+        bound_bels++;
+    }
+
+    size_t wire_idx = 0, pip_idx = 0;
+    for (size_t i = 0; i < nets.size(); i++) {
+        for (; wire_idx < wires_end[i]; wire_idx++) {
+            WireId wire = wires[wire_idx].first;
+            if (!in_grid(ctx, wire.location) || wire.index < 0 || wire.index >= ctx->locInfo(wire)->num_wires)
+                log_error("Checkpoint file '%s' routes net '%s' through an invalid wire.\n", filename.c_str(),
+                          ctx->nameOf(nets[i]));
+            if (!ctx->checkWireAvail(wire))
+                log_error("Checkpoint file '%s' routes net '%s' through wire %s, which is already used.\n",
+                          filename.c_str(), ctx->nameOf(nets[i]), ctx->nameOfWire(wire));
+            ctx->bindWire(wire, nets[i], wires[wire_idx].second);
+        }
+        for (; pip_idx < pips_end[i]; pip_idx++) {
+            PipId pip = pips[pip_idx].first;
+            if (!in_grid(ctx, pip.location) || pip.index < 0 || pip.index >= ctx->locInfo(pip)->num_pips)
+                log_error("Checkpoint file '%s' routes net '%s' through an invalid pip.\n", filename.c_str(),
+                          ctx->nameOf(nets[i]));
+            if (!ctx->checkPipAvail(pip) || !ctx->checkWireAvail(ctx->getPipDstWire(pip)))
+                log_error("Checkpoint file '%s' routes net '%s' through pip %s, which is already used.\n",
+                          filename.c_str(), ctx->nameOf(nets[i]), ctx->nameOfPip(pip));
+            ctx->bindPip(pip, nets[i], pips[pip_idx].second);
+        }
+    }
+
+    log_info("Loaded %d cells (%d placed) and %d nets with %d bound pips.\n", int(cells.size()), bound_bels,
+             int(nets.size()), int(pips.size()));
+}
+
+NEXTPNR_NAMESPACE_END
@@ -31,10 +31,12 @@
 #include <boost/program_options.hpp>
 #include <fstream>
 #include <iostream>
+#include "checkpoint.h"
 #include "command.h"
 #include "design_utils.h"
 #include "jsonparse.h"
 #include "log.h"
+#include "route_eco.h"
 #include "timing.h"
 #include "util.h"
 #include "version.h"
@@ -120,8 +122,27 @@ po::options_description CommandHandler::getGeneralOptions()
     general.add_options()("json", po::value<std::string>(), "JSON design file to ingest");
     general.add_options()("seed", po::value<int>(), "seed value for random number generator");
     general.add_options()("randomize-seed,r", "randomize seed value for random number generator");
+    general.add_options()("threads", po::value<int>(), "number of threads to use for placement and routing");
     general.add_options()("slack_redist_iter", po::value<int>(), "number of iterations between slack redistribution");
     general.add_options()("cstrweight", po::value<float>(), "placer weighting for relative constraint satisfaction");
+    general.add_options()("analytic-init", "use analytic placement instead of random initial placement");
+    general.add_options()("place-seeds", po::value<int>(),
+                          "run placement with this many different seeds in parallel and keep the best result");
+    general.add_options()("placer-effort", po::value<std::string>(),
+                          "placer effort level: low, normal (default) or high");
+    general.add_options()("place-time-limit", po::value<float>(),
+                          "stop annealing after this many seconds (results then depend on machine speed)");
+    general.add_options()("detailed-place", "run window-based detailed placement after simulated annealing");
+    general.add_options()("congestion-weight", po::value<float>(),
+                          "placer weighting for estimated routing congestion (default 0, disabled)");
+    general.add_options()("congestion-csv", po::value<std::string>(), "write placement congestion map to CSV file");
+    general.add_options()("router", po::value<std::string>(), "router to use: router1 (default) or pathfinder");
+    general.add_options()("router1-net-routing",
+                          "route all sinks of a net together, growing a tree from the source (router1)");
+    general.add_options()("save-routing", po::value<std::string>(), "write the routing result to a file");
+    general.add_options()("eco-routing", po::value<std::string>(),
+                          "reuse the routing of unchanged nets from a file written by --save-routing (router1)");
+    general.add_options()("tmg-ripup", "enable timing-driven ripup and replacement of critical paths after placement");
     general.add_options()("pack-only", "pack design only without placement or routing");
 
     general.add_options()("ignore-loops", "ignore combinational loops in timing analysis");
@@ -133,6 +154,10 @@ po::options_description CommandHandler::getGeneralOptions()
     general.add_options()("no-tmdriv", "disable timing-driven placement");
     general.add_options()("save", po::value<std::string>(), "project file to write");
     general.add_options()("load", po::value<std::string>(), "project file to read");
+    general.add_options()("save-checkpoint", po::value<std::string>(),
+                          "write the packed, placed and routed design to a binary checkpoint file");
+    general.add_options()("load-checkpoint", po::value<std::string>(),
+                          "read a design from a checkpoint file and write the bitstream without place and route");
     return general;
 }
 
@@ -164,6 +189,13 @@ void CommandHandler::setupContext(Context *ctx)
         ctx->rngseed(r);
     }
 
+    if (vm.count("threads")) {
+        int threads = vm["threads"].as<int>();
+        if (threads < 1)
+            log_error("Number of threads must be at least 1\n");
+        ctx->threads = threads;
+    }
+
     if (vm.count("slack_redist_iter")) {
         ctx->slack_redist_iter = vm["slack_redist_iter"].as<int>();
         if (vm.count("freq") && vm["freq"].as<double>() == 0) {
@@ -183,10 +215,63 @@ void CommandHandler::setupContext(Context *ctx)
         settings->set("timing/allowFail", true);
     }
 
+    if (vm.count("tmg-ripup")) {
+        settings->set("timing/tmgRipup", true);
+    }
+
     if (vm.count("cstrweight")) {
         settings->set("placer1/constraintWeight", vm["cstrweight"].as<float>());
     }
 
+    if (vm.count("analytic-init")) {
+        settings->set("placer1/analyticInit", true);
+    }
+
+    if (vm.count("placer-effort")) {
+        std::string effort = vm["placer-effort"].as<std::string>();
+        if (effort != "low" && effort != "normal" && effort != "high")
+            log_error("Placer effort must be one of low, normal or high\n");
+        settings->set("placer1/effort", effort);
+    }
+
+    if (vm.count("place-time-limit")) {
+        settings->set("placer1/timeLimit", vm["place-time-limit"].as<float>());
+    }
+
+    if (vm.count("detailed-place")) {
+        settings->set("placer1/detailedPlace", true);
+    }
+
+    if (vm.count("congestion-weight")) {
+        settings->set("placer1/congestionWeight", vm["congestion-weight"].as<float>());
+    }
+
+    if (vm.count("congestion-csv")) {
+        settings->set("placer1/congestionCsv", vm["congestion-csv"].as<std::string>());
+    }
+
+    if (vm.count("router")) {
+        std::string router = vm["router"].as<std::string>();
+        if (router != "router1" && router != "pathfinder")
+            log_error("Router must be one of router1 or pathfinder\n");
+        settings->set("router", router);
+    }
+
+    if (vm.count("router1-net-routing")) {
+        settings->set("router1/netRouting", true);
+    }
+
+    if (vm.count("eco-routing")) {
+        settings->set("route/ecoRouting", vm["eco-routing"].as<std::string>());
+    }
+
+    if (vm.count("place-seeds")) {
+        int seeds = vm["place-seeds"].as<int>();
+        if (seeds < 1)
+            log_error("Number of placement seeds must be at least 1\n");
+        settings->set("placer1/seeds", seeds);
+    }
+
     if (vm.count("freq")) {
         auto freq = vm["freq"].as<double>();
         if (freq > 0)
@@ -240,6 +325,11 @@ int CommandHandler::executeMain(std::unique_ptr<Context> ctx)
         customAfterLoad(ctx.get());
     }
 
+    if (vm.count("load-checkpoint")) {
+        load_checkpoint(ctx.get(), vm["load-checkpoint"].as<std::string>());
+        customAfterLoad(ctx.get());
+    }
+
 #ifndef NO_PYTHON
     init_python(argv[0], true);
     python_export_global("ctx", *ctx);
@@ -268,9 +358,18 @@ int CommandHandler::executeMain(std::unique_ptr<Context> ctx)
 
             if (!ctx->route() && !ctx->force)
                 log_error("Routing design failed.\n");
+
+            if (vm.count("save-routing"))
+                write_routing(ctx.get(), vm["save-routing"].as<std::string>());
         }
         run_script_hook("post-route");
 
+        if (vm.count("save-checkpoint"))
+            save_checkpoint(ctx.get(), vm["save-checkpoint"].as<std::string>());
+
+        customBitstream(ctx.get());
+    } else if (vm.count("load-checkpoint")) {
+        ctx->check();
         customBitstream(ctx.get());
     }
 
@@ -309,6 +408,10 @@ int CommandHandler::exec()
         if (!parseOptions())
             return -1;
 
+        // Checked before --load or --json read anything
+        conflicting_options(vm, "load-checkpoint", "json");
+        conflicting_options(vm, "load-checkpoint", "load");
+
         if (executeBeforeContext())
             return 0;
 
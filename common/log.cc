@@ -19,6 +19,7 @@
 
 #include <list>
 #include <map>
+#include <mutex>
 #include <set>
 #include <stdarg.h>
 #include <stdio.h>
@@ -41,6 +42,9 @@ void (*log_error_atexit)() = NULL;
 std::unordered_map<LogLevel, int> message_count_by_level;
 static int log_newline_count = 0;
 bool had_nonfatal_error = false;
+thread_local bool log_thread_quiet = false;
+// Messages may be logged from several threads at once
+static std::recursive_mutex log_mutex;
 
 std::string stringf(const char *fmt, ...)
 {
@@ -86,6 +90,10 @@ std::string vstringf(const char *fmt, va_list ap)
 
 void logv(const char *format, va_list ap, LogLevel level = LogLevel::LOG_MSG)
 {
+    if (log_thread_quiet && level < LogLevel::WARNING_MSG)
+        return;
+    std::lock_guard<std::recursive_mutex> lock(log_mutex);
+
     //
     // Trim newlines from the beginning
     while (format[0] == '\n' && format[1] != 0) {
@@ -113,6 +121,7 @@ void logv(const char *format, va_list ap, LogLevel level = LogLevel::LOG_MSG)
 
 void log_with_level(LogLevel level, const char *format, ...)
 {
+    std::lock_guard<std::recursive_mutex> lock(log_mutex);
     message_count_by_level[level]++;
     va_list ap;
     va_start(ap, format);
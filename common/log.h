@@ -57,6 +57,8 @@ extern log_write_type log_write_function;
 extern std::string log_last_error;
 extern void (*log_error_atexit)();
 extern bool had_nonfatal_error;
+// Suppress messages below warning level from the current thread, e.g. for placer runs in worker threads
+extern thread_local bool log_thread_quiet;
 extern std::unordered_map<LogLevel, int> message_count_by_level;
 
 std::string stringf(const char *fmt, ...);
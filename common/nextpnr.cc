@@ -407,6 +407,105 @@ void Context::check() const
     }
 }
 
+std::unique_ptr<Context> Context::cloneDesign() const
+{
+    std::unique_ptr<Context> clone(new Context(archArgs()));
+
+    // Replay the IdString database so that the same index refers to the same string in both contexts
+    for (int i = int(clone->idstring_idx_to_str->size()); i < int(idstring_idx_to_str->size()); i++)
+        IdString::initialize_add(clone.get(), idstring_idx_to_str->at(i)->c_str(), i);
+
+    clone->settings = settings;
+    clone->verbose = verbose;
+    clone->debug = debug;
+    clone->force = force;
+    clone->timing_driven = timing_driven;
+    clone->target_freq = target_freq;
+    clone->auto_freq = auto_freq;
+    clone->slack_redist_iter = slack_redist_iter;
+    clone->threads = threads;
+    clone->rngstate = rngstate;
+
+    std::unordered_map<const Region *, Region *> region_map;
+    for (auto &r : region) {
+        Region *cr = new Region(*r.second);
+        clone->region[r.first] = std::unique_ptr<Region>(cr);
+        region_map[r.second.get()] = cr;
+    }
+    auto map_region = [&](Region *r) { return r == nullptr ? nullptr : region_map.at(r); };
+
+    // Create all cells and nets first, then fix up the pointers between them
+    for (auto &c : cells) {
+        std::unique_ptr<CellInfo> ci(new CellInfo(*c.second));
+        ci->bel = BelId();
+        ci->belStrength = STRENGTH_NONE;
+        ci->region = map_region(ci->region);
+        clone->cells[c.first] = std::move(ci);
+    }
+    for (auto &n : nets) {
+        const NetInfo *ni = n.second.get();
+        std::unique_ptr<NetInfo> cn(new NetInfo());
+        *static_cast<ArchNetInfo *>(cn.get()) = *ni;
+        cn->name = ni->name;
+        cn->udata = ni->udata;
+        cn->driver = ni->driver;
+        cn->users = ni->users;
+        cn->attrs = ni->attrs;
+        if (ni->clkconstr)
+            cn->clkconstr = std::unique_ptr<ClockConstraint>(new ClockConstraint(*ni->clkconstr));
+        cn->tmg_id = ni->tmg_id;
+        cn->region = map_region(ni->region);
+        clone->nets[n.first] = std::move(cn);
+    }
+    auto map_cell = [&](CellInfo *c) { return c == nullptr ? nullptr : clone->cells.at(c->name).get(); };
+    for (auto &c : clone->cells) {
+        CellInfo *ci = c.second.get();
+        for (auto &port : ci->ports)
+            if (port.second.net != nullptr)
+                port.second.net = clone->nets.at(port.second.net->name).get();
+        ci->constr_parent = map_cell(ci->constr_parent);
+        for (auto &child : ci->constr_children)
+            child = map_cell(child);
+    }
+    for (auto &n : clone->nets) {
+        NetInfo *ni = n.second.get();
+        ni->driver.cell = map_cell(ni->driver.cell);
+        for (auto &usr : ni->users)
+            usr.cell = map_cell(usr.cell);
+    }
+
+    // Timing constraints
+    clone->constraintObjects = constraintObjects;
+    std::unordered_map<const TimingConstraint *, TimingConstraint *> constr_map;
+    for (auto &constr : constraints) {
+        TimingConstraint *cc = new TimingConstraint(*constr.second);
+        clone->constraints[constr.first] = std::unique_ptr<TimingConstraint>(cc);
+        constr_map[constr.second.get()] = cc;
+    }
+    for (auto &from : constrsFrom)
+        clone->constrsFrom.emplace(from.first, constr_map.at(from.second));
+    for (auto &to : constrsTo)
+        clone->constrsTo.emplace(to.first, constr_map.at(to.second));
+
+    // Existing placement
+    for (auto &c : cells)
+        if (c.second->bel != BelId())
+            clone->bindBel(c.second->bel, clone->cells.at(c.first).get(), c.second->belStrength);
+
+    // Existing routing, such as the edge clock nets that the packer locks down before placement
+    for (auto &n : nets) {
+        NetInfo *cn = clone->nets.at(n.first).get();
+        for (auto &w : n.second->wires) {
+            if (w.second.pip == PipId())
+                clone->bindWire(w.first, cn, w.second.strength);
+            else
+                clone->bindPip(w.second.pip, cn, w.second.strength);
+        }
+    }
+
+    return clone;
+}
+
 void BaseCtx::addClock(IdString net, float freq)
 {
     std::unique_ptr<ClockConstraint> cc(new ClockConstraint());
@@ -606,7 +606,13 @@ struct BaseCtx
 
     void refreshUiFrame() { frameUiReload = true; }
 
-    void refreshUiBel(BelId bel) { belUiReload.insert(bel); }
+    // Per-bel updates are redundant while a full reload is pending, this also means multithreaded
+    // placement can request a full reload up front and then leave the set untouched
+    void refreshUiBel(BelId bel)
+    {
+        if (!allUiReload)
+            belUiReload.insert(bel);
+    }
 
     void refreshUiWire(WireId wire) { wireUiReload.insert(wire); }
 
@@ -654,6 +660,7 @@ struct Context : Arch, DeterministicRNG
     float target_freq = 12e6;
     bool auto_freq = false;
     int slack_redist_iter = 0;
+    int threads = 1;
 
     Context(ArchArgs args) : Arch(args) {}
 
@@ -674,6 +681,10 @@ struct Context : Arch, DeterministicRNG
 
     void check() const;
     void archcheck() const;
+
+    // Create an independent copy of the design and its current bindings, including the settings and
+    // IdString database, so that it can be placed in parallel with this one
+    std::unique_ptr<Context> cloneDesign() const;
 };
 
 NEXTPNR_NAMESPACE_END
@@ -19,6 +19,7 @@
 
 #include "place_common.h"
 #include <cmath>
+#include <fstream>
 #include "log.h"
 #include "util.h"
 
@@ -116,9 +117,8 @@ bool place_single_cell(Context *ctx, CellInfo *cell, bool require_legality)
         if (cell->bel != BelId()) {
             ctx->unbindBel(cell->bel);
         }
-        IdString targetType = cell->type;
-        for (auto bel : ctx->getBels()) {
-            if (ctx->getBelType(bel) == targetType && (!require_legality || ctx->isValidBelForCell(cell, bel))) {
+        for (auto bel : ctx->getBelsByType(cell->type)) {
+            if (!require_legality || ctx->isValidBelForCell(cell, bel)) {
                 if (ctx->checkBelAvail(bel)) {
                     wirelen_t wirelen = get_cell_metric_at_bel(ctx, cell, bel, MetricType::COST);
                     if (iters >= 4)
@@ -529,4 +529,55 @@ int get_constraints_distance(const Context *ctx, const CellInfo *cell)
     return dist;
 }
 
+CongestionMap::CongestionMap(const Context *ctx, float pipsPerNet)
+        : width(ctx->getGridDimX()), height(ctx->getGridDimY())
+{
+    demand_.resize(width * height);
+    capacity_.resize(width * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            capacity_.at(y * width + x) = ctx->getTilePipCount(x, y) / pipsPerNet;
+}
+
+void CongestionMap::clear() { std::fill(demand_.begin(), demand_.end(), 0); }
+
+float CongestionMap::update(int x0, int y0, int x1, int y1, int sign)
+{
+    int w = x1 - x0 + 1, h = y1 - y0 + 1;
+    float density = sign * float(w + h - 1) / float(w * h);
+    float delta = 0;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            int idx = y * width + x;
+            float before = tile_overflow(idx);
+            demand_.at(idx) += density;
+            delta += tile_overflow(idx) - before;
+        }
+    }
+    return delta;
+}
+
+float CongestionMap::overflow() const
+{
+    float total = 0;
+    for (int i = 0; i < width * height; i++)
+        total += tile_overflow(i);
+    return total;
+}
+
+void CongestionMap::write_csv(const std::string &filename) const
+{
+    std::ofstream f(filename);
+    if (!f)
+        log_error("Failed to open congestion map file '%s' for writing\n", filename.c_str());
+    f << "x,y,demand,capacity,utilisation" << std::endl;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float d = demand(x, y), c = capacity(x, y);
+            f << x << "," << y << "," << d << "," << c << "," << (c > 0 ? d / c : 0) << std::endl;
+        }
+    }
+    log_info("Wrote congestion map to '%s'.\n", filename.c_str());
+}
+
 NEXTPNR_NAMESPACE_END
@@ -49,6 +49,37 @@ bool legalise_relative_constraints(Context *ctx);
 
 // Get the total distance from satisfied constraints for a cell
 int get_constraints_distance(const Context *ctx, const CellInfo *cell);
+
+// RUDY (rectangular uniform wire density) congestion estimate. Each net spreads its expected wirelength evenly
+// over the tiles of its bounding box; the sum of this demand is compared against a capacity for each tile
+// derived from its number of pips
+class CongestionMap
+{
+  public:
+    // pipsPerNet is the number of pips in a tile that are taken to support one unit of routing demand
+    CongestionMap(const Context *ctx, float pipsPerNet);
+
+    void clear();
+    // Add (sign = 1) or remove (sign = -1) the demand of a net with the given inclusive bounding box, returning
+    // the resulting change in overflow
+    float update(int x0, int y0, int x1, int y1, int sign);
+
+    float demand(int x, int y) const { return demand_.at(y * width + x); }
+    float capacity(int x, int y) const { return capacity_.at(y * width + x); }
+    // Sum over tiles of the demand in excess of capacity
+    float overflow() const;
+
+    void write_csv(const std::string &filename) const;
+
+  private:
+    float tile_overflow(int idx) const
+    {
+        return capacity_.at(idx) > 0 ? std::max(0.0f, demand_.at(idx) - capacity_.at(idx)) : 0.0f;
+    }
+
+    int width, height;
+    std::vector<float> demand_, capacity_;
+};
 NEXTPNR_NAMESPACE_END
 
 #endif
@@ -23,9 +23,13 @@
 
 #include "placer1.h"
 #include <algorithm>
+#include <atomic>
 #include <boost/lexical_cast.hpp>
+#include <boost/range/adaptor/reversed.hpp>
 #include <chrono>
 #include <cmath>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <list>
@@ -37,9 +41,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
 #include <vector>
 #include "log.h"
 #include "place_common.h"
+#include "placer_analytic.h"
 #include "timing.h"
 #include "util.h"
 
@@ -61,36 +67,51 @@ class SAPlacer
         }
         for (auto bel : ctx->getBels()) {
             Loc loc = ctx->getBelLocation(bel);
-            IdString type = ctx->getBelType(bel);
-            int type_idx = std::get<0>(bel_types.at(type));
-            int type_cnt = std::get<1>(bel_types.at(type));
-            if (type_cnt < cfg.minBelsForGridPick)
-                loc.x = loc.y = 0;
-            if (int(fast_bels.size()) < type_idx + 1)
-                fast_bels.resize(type_idx + 1);
-            if (int(fast_bels.at(type_idx).size()) < (loc.x + 1))
-                fast_bels.at(type_idx).resize(loc.x + 1);
-            if (int(fast_bels.at(type_idx).at(loc.x).size()) < (loc.y + 1))
-                fast_bels.at(type_idx).at(loc.x).resize(loc.y + 1);
             max_x = std::max(max_x, loc.x);
             max_y = std::max(max_y, loc.y);
-            fast_bels.at(type_idx).at(loc.x).at(loc.y).push_back(bel);
         }
         diameter = std::max(max_x, max_y) + 1;
 
         costs.resize(ctx->nets.size());
+        net_bounds.resize(ctx->nets.size());
+        new_net_bounds.resize(ctx->nets.size());
         old_udata.reserve(ctx->nets.size());
         decltype(NetInfo::udata) n = 0;
         for (auto &net : ctx->nets) {
             old_udata.emplace_back(net.second->udata);
             net.second->udata = n++;
         }
+        // Arcs of net n are numbered from arc_offset[n->udata] in user order
+        arc_offset.resize(ctx->nets.size() + 1);
+        for (auto &net : ctx->nets)
+            arc_offset.at(net.second->udata + 1) = net.second->users.size();
+        for (size_t i = 1; i < arc_offset.size(); i++)
+            arc_offset.at(i) += arc_offset.at(i - 1);
+        arc_weight.resize(arc_offset.back());
+        net_has_timing.resize(ctx->nets.size());
+        if (cfg.congestionWeight > 0 || !cfg.congestionCsv.empty())
+            congestion = std::unique_ptr<CongestionMap>(new CongestionMap(ctx, cfg.congestionPipsPerNet));
+        old_cell_udata.reserve(ctx->cells.size());
+        decltype(CellInfo::udata) c = 0;
+        for (auto &cell : ctx->cells) {
+            old_cell_udata.emplace_back(cell.second->udata);
+            cell.second->udata = c++;
+        }
+
+        serial_worker.rng = ctx;
+        serial_worker.x0 = serial_worker.y0 = 0;
+        serial_worker.x1 = max_x;
+        serial_worker.y1 = max_y;
+        // Keep regions a sensible number of columns wide so that most nets stay local
+        n_regions = std::max(1, std::min(ctx->threads, (max_x + 1) / min_region_width));
     }
 
     ~SAPlacer()
     {
         for (auto &net : ctx->nets)
             net.second->udata = old_udata[net.second->udata];
+        for (auto &cell : ctx->cells)
+            cell.second->udata = old_cell_udata[cell.second->udata];
     }
 
     bool place()
@@ -135,8 +156,8 @@ class SAPlacer
                 placed_cells++;
             }
         }
-        int constr_placed_cells = placed_cells;
         log_info("Placed %d cells based on constraints.\n", int(placed_cells));
+        build_bel_index();
         ctx->yield();
 
         // Sort to-place cells for deterministic initial placement
@@ -150,19 +171,46 @@ class SAPlacer
         std::sort(autoplaced.begin(), autoplaced.end(), [](CellInfo *a, CellInfo *b) { return a->name < b->name; });
         ctx->shuffle(autoplaced);
         auto iplace_start = std::chrono::high_resolution_clock::now();
+        if (cfg.analyticInit) {
+            if (!placer_analytic(ctx, AnalyticPlacerCfg(ctx), autoplaced))
+                log_error("Analytic placement failed.\n");
+            for (auto cell : autoplaced)
+                if (cell->bel != BelId())
+                    placed_cells++;
+        }
+        int pre_placed_cells = placed_cells;
         // Place cells randomly initially
-        log_info("Creating initial placement for remaining %d cells.\n", int(autoplaced.size()));
+        std::vector<CellInfo *> unplaced;
+        for (auto cell : autoplaced)
+            if (cell->bel == BelId())
+                unplaced.push_back(cell);
+        log_info("Creating initial placement for remaining %d cells.\n", int(unplaced.size()));
 
-        for (auto cell : autoplaced) {
+        for (auto cell : unplaced) {
             place_initial(cell);
             placed_cells++;
-            if ((placed_cells - constr_placed_cells) % 500 == 0)
-                log_info("  initial placement placed %d/%d cells\n", int(placed_cells - constr_placed_cells),
-                         int(autoplaced.size()));
+            if ((placed_cells - pre_placed_cells) % 500 == 0)
+                log_info("  initial placement placed %d/%d cells\n", int(placed_cells - pre_placed_cells),
+                         int(unplaced.size()));
+        }
+        if ((placed_cells - pre_placed_cells) % 500 != 0)
+            log_info("  initial placement placed %d/%d cells\n", int(placed_cells - pre_placed_cells),
+                     int(unplaced.size()));
+        // Legalise relative constraints once up front. Macros are then only ever moved as a whole, so they stay
+        // legal throughout annealing
+        legalise_relative_constraints(ctx);
+        autoplaced.clear();
+        for (auto cell : sorted(ctx->cells)) {
+            CellInfo *ci = cell.second;
+            if (is_macro_root(ci) && ci->constr_x == ci->UNCONSTR && ci->constr_y == ci->UNCONSTR)
+                unlock_macro(ci);
         }
-        if ((placed_cells - constr_placed_cells) % 500 != 0)
-            log_info("  initial placement placed %d/%d cells\n", int(placed_cells - constr_placed_cells),
-                     int(autoplaced.size()));
+        for (auto cell : sorted(ctx->cells)) {
+            CellInfo *ci = cell.second;
+            if (ci->belStrength < STRENGTH_STRONG && ci->constr_parent == nullptr)
+                autoplaced.push_back(ci);
+        }
+        ctx->shuffle(autoplaced);
         if (ctx->slack_redist_iter > 0)
             assign_budget(ctx);
         ctx->yield();
@@ -172,18 +220,23 @@ class SAPlacer
         log_info("Running simulated annealing placer.\n");
 
         // Calculate metric after initial placement
-        curr_metric = 0;
-        curr_tns = 0;
-        for (auto &net : ctx->nets) {
-            wirelen_t wl = get_net_metric(ctx, net.second.get(), MetricType::COST, curr_tns);
-            costs[net.second->udata] = CostChange{wl, -1};
-            curr_metric += wl;
-        }
+        if (ctx->timing_driven)
+            refresh_criticalities();
+        recompute_net_costs();
 
         int n_no_progress = 0;
         wirelen_t min_metric = curr_metric;
         double avg_metric = curr_metric;
-        temp = 10000;
+        if (cfg.analyticInit) {
+            // The analytic placement is already close to the final result, so only refine it
+            temp = analytic_start_temp;
+            diameter = std::min(diameter, analytic_start_dia);
+        } else {
+            temp = 10000;
+        }
+
+        if (n_regions > 1)
+            log_info("Running annealer on %d threads using %d regions.\n", ctx->threads, n_regions);
 
         // Main simulated annealing loop
         for (int iter = 1;; iter++) {
@@ -195,17 +248,13 @@ class SAPlacer
                          "%.0f, est tns = %.02fns\n",
                          iter, temp, double(curr_metric), curr_tns);
 
-            for (int m = 0; m < 15; ++m) {
-                // Loop through all automatically placed cells
-                for (auto cell : autoplaced) {
-                    // Find another random Bel for this cell
-                    BelId try_bel = random_bel_for_cell(cell);
-                    // If valid, try and swap to a new position and see if
-                    // the new position is valid/worthwhile
-                    if (try_bel != BelId() && try_bel != cell->bel)
-                        try_swap_position(cell, try_bel);
-                }
+            if (n_regions > 1)
+                run_parallel_moves(autoplaced, iter);
+            else {
+                do_moves(serial_worker, autoplaced);
+                commit_moves(serial_worker);
             }
+            total_moves += n_move;
 
             if (curr_metric < min_metric) {
                 min_metric = curr_metric;
@@ -218,14 +267,31 @@ class SAPlacer
             else
                 n_no_progress++;
 
-            if (temp <= 1e-3 && n_no_progress >= 5) {
+            double Raccept = n_move > 0 ? double(n_accept) / double(n_move) : 0;
+            metric_history.push_back(curr_metric);
+            if (int(metric_history.size()) > convergence_window + 1)
+                metric_history.pop_front();
+
+            bool done = false;
+            if (temp <= (cfg.detailedPlace ? detailed_end_temp : 1e-3) && n_no_progress >= 5) {
+                done = true;
+            } else if (Raccept < cfg.minAcceptRate && int(metric_history.size()) > convergence_window &&
+                       double(metric_history.front() - curr_metric) <
+                               cfg.minImprovement * double(metric_history.front())) {
+                log_info("  annealing converged at iteration #%d (acceptance rate %.03f)\n", iter, Raccept);
+                done = true;
+            } else if (cfg.timeLimit > 0 &&
+                       std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - saplace_start)
+                                       .count() >= cfg.timeLimit) {
+                log_info("  placement time limit of %.02fs reached at iteration #%d\n", cfg.timeLimit, iter);
+                done = true;
+            }
+            if (done) {
                 if (iter % 5 != 0)
                     log_info("  at iteration #%d: temp = %f, cost = %f\n", iter, temp, double(curr_metric));
                 break;
             }
 
-            double Raccept = double(n_accept) / double(n_move);
-
             int M = std::max(max_x, max_y) + 1;
 
             double upper = 0.6, lower = 0.4;
@@ -250,45 +316,38 @@ class SAPlacer
                         temp *= 0.8;
                 }
             }
-            // Once cooled below legalise threshold, run legalisation and start requiring
-            // legal moves only
-            if (temp < legalise_temp && require_legal) {
-                if (legalise_relative_constraints(ctx)) {
-                    // Only increase temperature if something was moved
-                    autoplaced.clear();
-                    for (auto cell : sorted(ctx->cells)) {
-                        if (cell.second->belStrength < STRENGTH_STRONG)
-                            autoplaced.push_back(cell.second);
-                    }
-                    temp = post_legalise_temp;
-                    diameter *= post_legalise_dia_scale;
-                    ctx->shuffle(autoplaced);
-
-                    // Legalisation is a big change so force a slack redistribution here
-                    if (ctx->slack_redist_iter > 0)
-                        assign_budget(ctx, true /* quiet */);
-                }
-                require_legal = false;
-            } else if (ctx->slack_redist_iter > 0 && iter % ctx->slack_redist_iter == 0) {
+            if (ctx->slack_redist_iter > 0 && iter % ctx->slack_redist_iter == 0) {
                 assign_budget(ctx, true /* quiet */);
             }
 
+            if (ctx->timing_driven && iter % cfg.critRefreshIter == 0)
+                refresh_criticalities();
+
             // Recalculate total metric entirely to avoid rounding errors
             // accumulating over time
-            curr_metric = 0;
-            curr_tns = 0;
-            for (auto &net : ctx->nets) {
-                wirelen_t wl = get_net_metric(ctx, net.second.get(), MetricType::COST, curr_tns);
-                costs[net.second->udata] = CostChange{wl, -1};
-                curr_metric += wl;
-            }
+            recompute_net_costs();
 
             // Let the UI show visualization updates.
             ctx->yield();
         }
 
+        if (cfg.detailedPlace)
+            detailed_place();
+
+        if (congestion) {
+            recompute_net_costs();
+            log_info("  estimated routing overflow %.0f\n", congestion->overflow());
+            if (!cfg.congestionCsv.empty())
+                congestion->write_csv(cfg.congestionCsv);
+        }
+
+        if (n_bounds_update > 0)
+            log_info("  %lld incremental net bounding box updates, %.1f%% needed a full recompute\n",
+                     (long long)n_bounds_update, 100.0 * n_bounds_fallback / n_bounds_update);
+
         auto saplace_end = std::chrono::high_resolution_clock::now();
-        log_info("SA placement time %.02fs\n", std::chrono::duration<float>(saplace_end - saplace_start).count());
+        float saplace_time = std::chrono::duration<float>(saplace_end - saplace_start).count();
+        log_info("SA placement time %.02fs (%.0f swaps/s)\n", saplace_time, total_moves / saplace_time);
 
         // Final post-pacement validitiy check
         ctx->yield();
@@ -333,22 +392,26 @@ class SAPlacer
             if (cell->bel != BelId()) {
                 ctx->unbindBel(cell->bel);
             }
-            IdString targetType = cell->type;
-            for (auto bel : ctx->getBels()) {
-                if (ctx->getBelType(bel) == targetType && ctx->isValidBelForCell(cell, bel)) {
-                    if (ctx->checkBelAvail(bel)) {
-                        uint64_t score = ctx->rng64();
-                        if (score <= best_score) {
-                            best_score = score;
-                            best_bel = bel;
-                        }
-                    } else {
-                        uint64_t score = ctx->rng64();
-                        CellInfo *bound_cell = ctx->getBoundBelCell(bel);
-                        if (score <= best_ripup_score && bound_cell->belStrength < STRENGTH_STRONG) {
-                            best_ripup_score = score;
-                            ripup_target = bound_cell;
-                            ripup_bel = bel;
+            // Usually a free bel can be found by sampling, only if that fails do we need to consider
+            // every bel of the type and look for a ripup candidate
+            best_bel = sample_free_bel(cell);
+            if (best_bel == BelId()) {
+                for (auto bel : ctx->getBelsByType(cell->type)) {
+                    if (ctx->isValidBelForCell(cell, bel)) {
+                        if (ctx->checkBelAvail(bel)) {
+                            uint64_t score = ctx->rng64();
+                            if (score <= best_score) {
+                                best_score = score;
+                                best_bel = bel;
+                            }
+                        } else {
+                            uint64_t score = ctx->rng64();
+                            CellInfo *bound_cell = ctx->getBoundBelCell(bel);
+                            if (score <= best_ripup_score && bound_cell->belStrength < STRENGTH_STRONG) {
+                                best_ripup_score = score;
+                                ripup_target = bound_cell;
+                                ripup_bel = bel;
+                            }
                         }
                     }
                 }
@@ -370,46 +433,424 @@ class SAPlacer
         }
     }
 
+    // Pick a random free bel that is valid for a cell, or BelId() if none was found after a number of tries.
+    // Bels that have become bound since the pool was created are dropped from it as they are sampled
+    BelId sample_free_bel(CellInfo *cell)
+    {
+        auto fnd = free_bels.find(cell->type);
+        if (fnd == free_bels.end()) {
+            std::vector<BelId> pool;
+            for (auto bel : ctx->getBelsByType(cell->type))
+                if (ctx->checkBelAvail(bel))
+                    pool.push_back(bel);
+            fnd = free_bels.emplace(cell->type, std::move(pool)).first;
+        }
+        auto &pool = fnd->second;
+        int tries = 0;
+        while (!pool.empty() && tries < max_free_bel_tries) {
+            int idx = ctx->rng(int(pool.size()));
+            BelId bel = pool.at(idx);
+            if (!ctx->checkBelAvail(bel)) {
+                pool.at(idx) = pool.back();
+                pool.pop_back();
+                continue;
+            }
+            if (ctx->isValidBelForCell(cell, bel))
+                return bel;
+            tries++;
+        }
+        return BelId();
+    }
+
+    // Bounding box of a net, with the number of pins on each edge so that it can be updated
+    // incrementally as pins move. This matches the wirelength calculation in get_net_metric
+    struct NetBounds
+    {
+        int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+        int n_x0 = 0, n_x1 = 0, n_y0 = 0, n_y1 = 0;
+        // Net has no driver or is globally routed, so has no cost
+        bool no_cost = false;
+        // Set during a swap once the incremental update is no longer possible
+        bool stale = false;
+
+        wirelen_t hpwl() const { return no_cost ? 0 : (x1 - x0) + (y1 - y0); }
+    };
+
+    // Recompute the cost and bounding box of every net from scratch
+    void recompute_net_costs()
+    {
+        curr_metric = 0;
+        if (congestion)
+            congestion->clear();
+        for (auto &net : ctx->nets) {
+            NetBounds &nb = net_bounds[net.second->udata];
+            nb = get_net_bounds(net.second.get());
+            wirelen_t wl = get_net_cost(net.second.get(), nb);
+            costs[net.second->udata] = CostChange{wl, -1};
+            curr_metric += wl;
+            if (congestion && !nb.no_cost && congestion_tracked(net.second.get()))
+                congestion->update(nb.x0, nb.y0, nb.x1, nb.y1, 1);
+        }
+    }
+
+    // Run timing analysis and cache the criticality of every arc as its timing cost weight, so that the
+    // cost function never has to compute delays or slacks itself
+    void refresh_criticalities()
+    {
+        NetCriticalityMap net_crit;
+        get_criticalities(ctx, &net_crit);
+        curr_tns = 0;
+        for (auto &net : ctx->nets) {
+            NetInfo *ni = net.second.get();
+            size_t offset = arc_offset.at(ni->udata);
+            std::fill(arc_weight.begin() + offset, arc_weight.begin() + arc_offset.at(ni->udata + 1), 0);
+            net_has_timing.at(ni->udata) = false;
+            int clock_count;
+            if (ni->driver.cell == nullptr ||
+                ctx->getPortTimingClass(ni->driver.cell, ni->driver.port, clock_count) == TMG_IGNORE)
+                continue;
+            auto fnd = net_crit.find(net.first);
+            if (fnd == net_crit.end())
+                continue;
+            const auto &nc = fnd->second;
+            for (size_t i = 0; i < nc.slack.size(); i++)
+                if (nc.slack.at(i) < 0)
+                    curr_tns += ctx->getDelayNS(nc.slack.at(i));
+            for (size_t i = 0; i < nc.criticality.size(); i++) {
+                float weight = std::pow(nc.criticality.at(i), cfg.critExponent);
+                if (weight < min_arc_weight)
+                    continue;
+                arc_weight.at(offset + i) = weight;
+                net_has_timing.at(ni->udata) = true;
+            }
+        }
+    }
+
+    // Cost of a net given its bounding box: the HPWL, plus the distance from the driver to each sink weighted by
+    // the cached criticality of that arc
+    wirelen_t get_net_cost(const NetInfo *net, const NetBounds &nb) const
+    {
+        if (nb.no_cost || !net_has_timing.at(net->udata))
+            return nb.hpwl();
+        Loc driver_loc = ctx->getBelLocation(net->driver.cell->bel);
+        const float *weights = arc_weight.data() + arc_offset.at(net->udata);
+        float timing_cost = 0;
+        for (size_t i = 0; i < net->users.size(); i++) {
+            if (weights[i] == 0)
+                continue;
+            const CellInfo *load = net->users.at(i).cell;
+            if (load == nullptr || load->bel == BelId())
+                continue;
+            Loc load_loc = ctx->getBelLocation(load->bel);
+            timing_cost += weights[i] * (std::abs(load_loc.x - driver_loc.x) + std::abs(load_loc.y - driver_loc.y));
+        }
+        return nb.hpwl() + wirelen_t(cfg.timingWeight * timing_cost);
+    }
+
+    // A pin moving as part of a swap
+    struct PinMove
+    {
+        NetInfo *net;
+        bool is_driver;
+        BelId old_bel, new_bel;
+    };
+
+    static void bounds_add(int &lo, int &hi, int &n_lo, int &n_hi, int v)
+    {
+        if (v < lo) {
+            lo = v;
+            n_lo = 1;
+        } else if (v == lo) {
+            n_lo++;
+        }
+        if (v > hi) {
+            hi = v;
+            n_hi = 1;
+        } else if (v == hi) {
+            n_hi++;
+        }
+    }
+
+    // Returns false if the last pin on an edge was removed, in which case the new edge is unknown
+    static bool bounds_remove(int &lo, int &hi, int &n_lo, int &n_hi, int v)
+    {
+        if (v == lo && --n_lo == 0)
+            return false;
+        if (v == hi && --n_hi == 0)
+            return false;
+        return true;
+    }
+
+    NetBounds get_net_bounds(const NetInfo *net) const
+    {
+        NetBounds nb;
+        CellInfo *driver = net->driver.cell;
+        if (driver == nullptr || driver->bel == BelId() || ctx->getBelGlobalBuf(driver->bel)) {
+            nb.no_cost = true;
+            return nb;
+        }
+        Loc driver_loc = ctx->getBelLocation(driver->bel);
+        nb.x0 = nb.x1 = driver_loc.x;
+        nb.y0 = nb.y1 = driver_loc.y;
+        nb.n_x0 = nb.n_x1 = nb.n_y0 = nb.n_y1 = 1;
+        for (auto &load : net->users) {
+            if (load.cell == nullptr || load.cell->bel == BelId() || ctx->getBelGlobalBuf(load.cell->bel))
+                continue;
+            Loc load_loc = ctx->getBelLocation(load.cell->bel);
+            bounds_add(nb.x0, nb.x1, nb.n_x0, nb.n_x1, load_loc.x);
+            bounds_add(nb.y0, nb.y1, nb.n_y0, nb.n_y1, load_loc.y);
+        }
+        return nb;
+    }
+
+    // Update a bounding box for a single pin moving, returns false if it needs to be recomputed from scratch
+    bool move_pin(NetBounds &nb, const PinMove &m) const
+    {
+        bool old_gb = ctx->getBelGlobalBuf(m.old_bel), new_gb = ctx->getBelGlobalBuf(m.new_bel);
+        if (m.is_driver && (old_gb || new_gb))
+            return false;
+        if (nb.no_cost)
+            return true;
+        // Pins on global buffers don't count towards the bounding box
+        if (!new_gb) {
+            Loc new_loc = ctx->getBelLocation(m.new_bel);
+            bounds_add(nb.x0, nb.x1, nb.n_x0, nb.n_x1, new_loc.x);
+            bounds_add(nb.y0, nb.y1, nb.n_y0, nb.n_y1, new_loc.y);
+        }
+        if (!old_gb) {
+            Loc old_loc = ctx->getBelLocation(m.old_bel);
+            if (!bounds_remove(nb.x0, nb.x1, nb.n_x0, nb.n_x1, old_loc.x) ||
+                !bounds_remove(nb.y0, nb.y1, nb.n_y0, nb.n_y1, old_loc.y))
+                return false;
+        }
+        return true;
+    }
+
+    // A cell moving as part of a macro move
+    struct CellMove
+    {
+        CellInfo *cell;
+        BelId old_bel, new_bel;
+    };
+
+    // State for one stream of annealer moves. The serial annealer uses a single worker driven by the
+    // context RNG covering the whole grid; in parallel mode each region gets its own worker and RNG
+    struct SwapWorker
+    {
+        DeterministicRNG *rng = nullptr;
+        DeterministicRNG region_rng;
+        // Inclusive bounds of the region this worker may move cells within
+        int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+        // Only set for region workers, which must not touch cells or nets shared with other regions
+        bool parallel = false;
+        int region = -1;
+        std::vector<CellInfo *> cells;
+        std::vector<NetInfo *> updates;
+        std::vector<PinMove> moves;
+        // Nets whose demand in the congestion map was moved by the current perturbation
+        std::vector<NetInfo *> cong_updates;
+        // Scratch space for macro moves
+        std::vector<CellInfo *> macro_cells;
+        std::vector<CellMove> cell_moves;
+        std::unordered_set<BelId> macro_old_bels, macro_new_bels;
+        wirelen_t delta_metric = 0;
+        int n_move = 0, n_accept = 0;
+        int64_t n_bounds_update = 0, n_bounds_fallback = 0;
+    };
+
+    // Run the usual 15 passes of moves over a set of cells
+    void do_moves(SwapWorker &w, const std::vector<CellInfo *> &cells)
+    {
+        w.delta_metric = 0;
+        w.n_move = w.n_accept = 0;
+        w.n_bounds_update = w.n_bounds_fallback = 0;
+        for (int m = 0; m < cfg.movesPerTemp; ++m) {
+            // Loop through all automatically placed cells
+            for (auto cell : cells) {
+                // Find another random Bel for this cell
+                BelId try_bel = random_bel_for_cell(w, cell);
+                // If valid, try and swap to a new position and see if
+                // the new position is valid/worthwhile
+                if (try_bel == BelId() || try_bel == cell->bel)
+                    continue;
+                if (is_macro_root(cell))
+                    try_swap_chain(w, cell, try_bel);
+                else
+                    try_swap_position(w, cell, try_bel);
+            }
+        }
+    }
+
+    // Fold the result of a worker's moves back into the global metric and acceptance counters
+    void commit_moves(const SwapWorker &w)
+    {
+        curr_metric += w.delta_metric;
+        n_move += w.n_move;
+        n_accept += w.n_accept;
+        n_bounds_update += w.n_bounds_update;
+        n_bounds_fallback += w.n_bounds_fallback;
+    }
+
+    // Split the grid into vertical strips, one per worker. Odd iterations shift the strip boundaries
+    // by half a strip so that cells near a border get the chance to move across it over time
+    void setup_regions(int iter)
+    {
+        int width = max_x + 1;
+        int offset = (iter % 2) ? (width / n_regions) / 2 : 0;
+        region_workers.resize(n_regions);
+        for (int i = 0; i < n_regions; i++) {
+            auto &w = region_workers.at(i);
+            w.rng = &w.region_rng;
+            w.parallel = true;
+            w.region = i;
+            w.x0 = (i == 0) ? 0 : (i * width) / n_regions + offset;
+            w.x1 = (i == n_regions - 1) ? max_x : ((i + 1) * width) / n_regions + offset - 1;
+            w.y0 = 0;
+            w.y1 = max_y;
+            w.cells.clear();
+            // Seeds are drawn serially in region order, so results only depend on the seed and
+            // thread count and not on how the threads are scheduled
+            w.region_rng.rngseed(ctx->rng64());
+        }
+    }
+
+    int region_for_x(int x) const
+    {
+        for (int i = 0; i < n_regions; i++)
+            if (x >= region_workers.at(i).x0 && x <= region_workers.at(i).x1)
+                return i;
+        NPNR_ASSERT_FALSE("location outside of all placer regions");
+    }
+
+    // A net whose cost can never change is ignored for locality purposes
+    bool is_static_net(const NetInfo *net) const
+    {
+        CellInfo *driver = net->driver.cell;
+        return driver == nullptr || (driver->bel != BelId() && ctx->getBelGlobalBuf(driver->bel));
+    }
+
+    // Evaluate moves in all regions concurrently. A cell can be moved by a region worker if it, and every
+    // other movable cell on its nets, is inside that region; everything else is moved afterwards by the
+    // serial worker, which is where moves crossing region borders are reconciled
+    void run_parallel_moves(const std::vector<CellInfo *> &autoplaced, int iter)
+    {
+        setup_regions(iter);
+
+        cell_region.assign(ctx->cells.size(), REGION_NONE);
+        for (auto cell : autoplaced)
+            cell_region.at(cell->udata) = region_for_x(ctx->getBelLocation(cell->bel).x);
+
+        net_region.assign(ctx->nets.size(), REGION_NONE);
+        for (auto &net : ctx->nets) {
+            NetInfo *ni = net.second.get();
+            int &nr = net_region.at(ni->udata);
+            if (is_static_net(ni)) {
+                nr = REGION_STATIC;
+                continue;
+            }
+            auto add_cell = [&](const CellInfo *ci) {
+                if (ci == nullptr || nr == REGION_SHARED)
+                    return;
+                int cr = cell_region.at(ci->udata);
+                if (cr == REGION_NONE)
+                    return; // fixed cells never move, so are safe to read from any thread
+                nr = (nr == REGION_NONE || nr == cr) ? cr : REGION_SHARED;
+            };
+            add_cell(ni->driver.cell);
+            for (auto &usr : ni->users)
+                add_cell(usr.cell);
+            // Fixed pins can stretch a net's bounding box outside the region of its movable cells. Such nets
+            // would write to another region's part of the congestion map, so their cells are moved serially
+            if (nr >= 0 && cfg.congestionWeight > 0 && congestion_tracked(ni)) {
+                const NetBounds &nb = net_bounds[ni->udata];
+                const auto &rw = region_workers.at(nr);
+                if (!nb.no_cost && (nb.x0 < rw.x0 || nb.x1 > rw.x1))
+                    nr = REGION_SHARED;
+            }
+        }
+
+        std::vector<CellInfo *> remaining;
+        for (auto cell : autoplaced) {
+            int cr = cell_region.at(cell->udata);
+            bool local = std::get<1>(bel_types.at(cell->type)) >= cfg.minBelsForGridPick &&
+                         cell->constr_parent == nullptr && cell->constr_children.empty();
+            for (auto &port : cell->ports) {
+                if (!local)
+                    break;
+                if (port.second.net == nullptr)
+                    continue;
+                int nr = net_region.at(port.second.net->udata);
+                if (nr != REGION_STATIC && nr != cr)
+                    local = false;
+            }
+            if (local)
+                region_workers.at(cr).cells.push_back(cell);
+            else
+                remaining.push_back(cell);
+        }
+        for (auto cell : remaining)
+            cell_region.at(cell->udata) = REGION_SHARED;
+
+        // The UI is fully refreshed once the placer is done, so workers never need to touch the
+        // (unsynchronised) per-bel refresh set
+        ctx->refreshUi();
+
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(n_regions);
+        for (int i = 0; i < n_regions; i++) {
+            threads.emplace_back([this, i, &errors]() {
+                try {
+                    do_moves(region_workers.at(i), region_workers.at(i).cells);
+                } catch (...) {
+                    errors.at(i) = std::current_exception();
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        for (auto &e : errors)
+            if (e)
+                std::rethrow_exception(e);
+
+        for (auto &w : region_workers)
+            commit_moves(w);
+
+        if (ctx->verbose)
+            log_info("    %d cells moved in parallel, %d serially\n", int(autoplaced.size() - remaining.size()),
+                     int(remaining.size()));
+
+        do_moves(serial_worker, remaining);
+        commit_moves(serial_worker);
+    }
+
     // Attempt a SA position swap, return true on success or false on failure
-    bool try_swap_position(CellInfo *cell, BelId newBel)
+    bool try_swap_position(SwapWorker &w, CellInfo *cell, BelId newBel)
     {
-        static std::vector<NetInfo *> updates;
-        updates.clear();
+        w.updates.clear();
+        w.moves.clear();
         BelId oldBel = cell->bel;
         CellInfo *other_cell = ctx->getBoundBelCell(newBel);
-        if (other_cell != nullptr && other_cell->belStrength > STRENGTH_WEAK) {
+        if (other_cell != nullptr && (other_cell->belStrength > STRENGTH_WEAK || is_macro_cell(other_cell))) {
+            return false;
+        }
+        // Region workers may only swap with cells that they own
+        if (w.parallel && other_cell != nullptr && cell_region.at(other_cell->udata) != w.region) {
             return false;
         }
         int old_dist = get_constraints_distance(ctx, cell);
         int new_dist;
         if (other_cell != nullptr)
             old_dist += get_constraints_distance(ctx, other_cell);
-        wirelen_t new_metric = 0, delta;
+        wirelen_t delta_wl = 0;
+        double delta;
         ctx->unbindBel(oldBel);
         if (other_cell != nullptr) {
             ctx->unbindBel(newBel);
         }
 
-        for (const auto &port : cell->ports) {
-            if (port.second.net != nullptr) {
-                auto &cost = costs[port.second.net->udata];
-                if (cost.new_cost == 0)
-                    continue;
-                cost.new_cost = 0;
-                updates.emplace_back(port.second.net);
-            }
-        }
-
-        if (other_cell != nullptr) {
-            for (const auto &port : other_cell->ports)
-                if (port.second.net != nullptr) {
-                    auto &cost = costs[port.second.net->udata];
-                    if (cost.new_cost == 0)
-                        continue;
-                    cost.new_cost = 0;
-                    updates.emplace_back(port.second.net);
-                }
-        }
+        add_pin_moves(w, cell, oldBel, newBel);
+        if (other_cell != nullptr)
+            add_pin_moves(w, other_cell, newBel, oldBel);
 
         ctx->bindBel(newBel, cell, STRENGTH_WEAK);
 
@@ -423,75 +864,660 @@ class SAPlacer
             goto swap_fail;
         }
 
-        new_metric = curr_metric;
-
-        // Recalculate metrics for all nets touched by the peturbation
-        for (const auto &net : updates) {
-            auto &c = costs[net->udata];
-            new_metric -= c.curr_cost;
-            float temp_tns = 0;
-            wirelen_t net_new_wl = get_net_metric(ctx, net, MetricType::COST, temp_tns);
-            new_metric += net_new_wl;
-            c.new_cost = net_new_wl;
-        }
+        delta_wl = update_net_costs(w);
 
         new_dist = get_constraints_distance(ctx, cell);
         if (other_cell != nullptr)
             new_dist += get_constraints_distance(ctx, other_cell);
-        delta = new_metric - curr_metric;
+        delta = delta_wl + update_congestion(w);
         delta += (cfg.constraintWeight / temp) * (new_dist - old_dist);
-        n_move++;
+        w.n_move++;
         // SA acceptance criterea
-        if (delta < 0 || (temp > 1e-6 && (ctx->rng() / float(0x3fffffff)) <= std::exp(-delta / temp))) {
-            n_accept++;
+        if (delta < 0 || (temp > 1e-6 && (w.rng->rng() / float(0x3fffffff)) <= std::exp(-delta / temp))) {
+            w.n_accept++;
         } else {
             if (other_cell != nullptr)
                 ctx->unbindBel(oldBel);
             ctx->unbindBel(newBel);
             goto swap_fail;
         }
-        curr_metric = new_metric;
-        for (const auto &net : updates) {
-            auto &c = costs[net->udata];
-            c = CostChange{c.new_cost, -1};
-        }
-
+        w.delta_metric += delta_wl;
+        commit_net_costs(w);
         return true;
     swap_fail:
         ctx->bindBel(oldBel, cell, STRENGTH_WEAK);
         if (other_cell != nullptr) {
             ctx->bindBel(newBel, other_cell, STRENGTH_WEAK);
         }
-        for (const auto &net : updates)
-            costs[net->udata].new_cost = -1;
+        revert_net_costs(w);
+        return false;
+    }
+
+    // Attempt to move a whole relative placement macro so that its root ends up in the same tile as newBel,
+    // keeping the relative positions of all its cells. Cells in the way are moved to the bels the macro frees up
+    bool try_swap_chain(SwapWorker &w, CellInfo *root, BelId newBel)
+    {
+        w.updates.clear();
+        w.moves.clear();
+        Loc root_loc = ctx->getBelLocation(root->bel), new_root_loc = ctx->getBelLocation(newBel);
+        int dx = new_root_loc.x - root_loc.x, dy = new_root_loc.y - root_loc.y;
+        if (dx == 0 && dy == 0)
+            return false;
+
+        auto &macro = w.macro_cells;
+        macro.clear();
+        get_macro_cells(root, macro);
+        auto &cell_moves = w.cell_moves;
+        cell_moves.clear();
+        auto &old_bels = w.macro_old_bels, &new_bels = w.macro_new_bels;
+        old_bels.clear();
+        new_bels.clear();
+        for (auto cell : macro)
+            old_bels.insert(cell->bel);
+
+        // Every cell of the macro must land on a bel of the right type, that is either free or holds a weakly
+        // placed cell which isn't itself part of a macro
+        std::vector<CellInfo *> displaced;
+        for (auto cell : macro) {
+            Loc loc = ctx->getBelLocation(cell->bel);
+            loc.x += dx;
+            loc.y += dy;
+            if (loc.x < w.x0 || loc.x > w.x1 || loc.y < w.y0 || loc.y > w.y1)
+                return false;
+            BelId target = ctx->getBelByLocation(loc);
+            if (target == BelId() || ctx->getBelType(target) != cell->type || locked_bels.count(target))
+                return false;
+            CellInfo *bound = ctx->getBoundBelCell(target);
+            if (bound != nullptr && !old_bels.count(target)) {
+                if (bound->belStrength > STRENGTH_WEAK || is_macro_cell(bound))
+                    return false;
+                if (w.parallel && cell_region.at(bound->udata) != w.region)
+                    return false;
+                displaced.push_back(bound);
+            }
+            cell_moves.push_back(CellMove{cell, cell->bel, target});
+            new_bels.insert(target);
+        }
+        // Displaced cells fill the bels the macro vacated, in macro order which keeps them roughly in place
+        size_t next_free = 0;
+        for (auto cell : displaced) {
+            while (next_free < macro.size() && new_bels.count(macro.at(next_free)->bel))
+                next_free++;
+            NPNR_ASSERT(next_free < macro.size());
+            BelId free_bel = macro.at(next_free++)->bel;
+            if (ctx->getBelType(free_bel) != cell->type)
+                return false;
+            cell_moves.push_back(CellMove{cell, cell->bel, free_bel});
+        }
+
+        for (auto &cm : cell_moves) {
+            add_pin_moves(w, cm.cell, cm.old_bel, cm.new_bel);
+            ctx->unbindBel(cm.old_bel);
+        }
+        for (auto &cm : cell_moves)
+            ctx->bindBel(cm.new_bel, cm.cell, STRENGTH_WEAK);
+        bool legal = true;
+        for (auto &cm : cell_moves)
+            if (!ctx->isBelLocationValid(cm.new_bel))
+                legal = false;
+
+        if (legal) {
+            wirelen_t delta_wl = update_net_costs(w);
+            double delta = delta_wl + update_congestion(w);
+            w.n_move++;
+            if (delta < 0 || (temp > 1e-6 && (w.rng->rng() / float(0x3fffffff)) <= std::exp(-delta / temp))) {
+                w.n_accept++;
+                w.delta_metric += delta_wl;
+                commit_net_costs(w);
+                return true;
+            }
+        }
+
+        for (auto &cm : cell_moves)
+            ctx->unbindBel(cm.new_bel);
+        for (auto &cm : cell_moves)
+            ctx->bindBel(cm.old_bel, cm.cell, STRENGTH_WEAK);
+        revert_net_costs(w);
         return false;
     }
 
-    // Find a random Bel of the correct type for a cell, within the specified
-    // diameter
-    BelId random_bel_for_cell(CellInfo *cell)
-    {
-        IdString targetType = cell->type;
-        Loc curr_loc = ctx->getBelLocation(cell->bel);
-        while (true) {
-            int nx = ctx->rng(2 * diameter + 1) + std::max(curr_loc.x - diameter, 0);
-            int ny = ctx->rng(2 * diameter + 1) + std::max(curr_loc.y - diameter, 0);
-            int beltype_idx, beltype_cnt;
-            std::tie(beltype_idx, beltype_cnt) = bel_types.at(targetType);
-            if (beltype_cnt < cfg.minBelsForGridPick)
-                nx = ny = 0;
-            if (nx >= int(fast_bels.at(beltype_idx).size()))
+    // Record the pins of a cell that is being moved, and mark the nets they are on as needing an update
+    void add_pin_moves(SwapWorker &w, CellInfo *cell, BelId old_bel, BelId new_bel)
+    {
+        for (const auto &port : cell->ports) {
+            if (port.second.net == nullptr)
+                continue;
+            if (w.parallel && net_region.at(port.second.net->udata) == REGION_STATIC)
                 continue;
-            if (ny >= int(fast_bels.at(beltype_idx).at(nx).size()))
+            w.moves.push_back(PinMove{port.second.net, is_driver_port(cell, port.second), old_bel, new_bel});
+            auto &cost = costs[port.second.net->udata];
+            if (cost.new_cost == 0)
                 continue;
-            const auto &fb = fast_bels.at(beltype_idx).at(nx).at(ny);
-            if (fb.size() == 0)
+            cost.new_cost = 0;
+            w.updates.emplace_back(port.second.net);
+        }
+    }
+
+    // Recalculate metrics for all nets touched by the peturbation, using incremental bounding box
+    // updates where possible. Returns the change in total cost
+    wirelen_t update_net_costs(SwapWorker &w)
+    {
+        wirelen_t delta_wl = 0;
+        for (const auto &net : w.updates) {
+            new_net_bounds[net->udata] = net_bounds[net->udata];
+            new_net_bounds[net->udata].stale = false;
+        }
+        for (const auto &m : w.moves) {
+            auto &nb = new_net_bounds[m.net->udata];
+            if (!nb.stale && !move_pin(nb, m))
+                nb.stale = true;
+        }
+        for (const auto &net : w.updates) {
+            auto &c = costs[net->udata];
+            auto &nb = new_net_bounds[net->udata];
+            w.n_bounds_update++;
+            if (nb.stale) {
+                nb = get_net_bounds(net);
+                w.n_bounds_fallback++;
+            }
+            wirelen_t net_new_wl = get_net_cost(net, nb);
+            delta_wl += net_new_wl - c.curr_cost;
+            c.new_cost = net_new_wl;
+        }
+        return delta_wl;
+    }
+
+    void commit_net_costs(SwapWorker &w)
+    {
+        for (const auto &net : w.updates) {
+            auto &c = costs[net->udata];
+            c = CostChange{c.new_cost, -1};
+            net_bounds[net->udata] = new_net_bounds[net->udata];
+        }
+        w.cong_updates.clear();
+    }
+
+    void revert_net_costs(SwapWorker &w)
+    {
+        for (const auto &net : w.updates)
+            costs[net->udata].new_cost = -1;
+        for (auto net : boost::adaptors::reverse(w.cong_updates)) {
+            congestion_update(new_net_bounds[net->udata], -1);
+            congestion_update(net_bounds[net->udata], 1);
+        }
+        w.cong_updates.clear();
+    }
+
+    bool congestion_tracked(const NetInfo *net) const { return int(net->users.size()) <= max_congestion_fanout; }
+
+    // Apply a bounding box to the congestion map, ignoring nets without a cost
+    float congestion_update(const NetBounds &nb, int sign)
+    {
+        if (nb.no_cost)
+            return 0;
+        return congestion->update(nb.x0, nb.y0, nb.x1, nb.y1, sign);
+    }
+
+    // Move the demand of the nets changed by a perturbation in the congestion map, returning the weighted change
+    // in overflow, unrounded so that small changes still count. Region workers only move cells whose nets have
+    // bounding boxes inside their region (see run_parallel_moves), and as fixed pins are then inside it too, the
+    // boxes stay there; so the map is never written to concurrently
+    double update_congestion(SwapWorker &w)
+    {
+        if (cfg.congestionWeight <= 0)
+            return 0;
+        auto inside = [&](const NetBounds &nb) { return nb.no_cost || (nb.x0 >= w.x0 && nb.x1 <= w.x1); };
+        float delta = 0;
+        for (auto net : w.updates) {
+            if (!congestion_tracked(net))
                 continue;
-            BelId bel = fb.at(ctx->rng(int(fb.size())));
-            if (locked_bels.find(bel) != locked_bels.end())
+            const NetBounds &ob = net_bounds[net->udata], &nb = new_net_bounds[net->udata];
+            if (ob.no_cost == nb.no_cost && ob.x0 == nb.x0 && ob.x1 == nb.x1 && ob.y0 == nb.y0 && ob.y1 == nb.y1)
                 continue;
-            return bel;
+            NPNR_ASSERT(!w.parallel || (inside(ob) && inside(nb)));
+            delta += congestion_update(ob, -1);
+            delta += congestion_update(nb, 1);
+            w.cong_updates.push_back(net);
         }
+        return double(cfg.congestionWeight) * delta;
+    }
+
+    static bool is_macro_root(const CellInfo *cell)
+    {
+        return cell->constr_parent == nullptr && !cell->constr_children.empty();
+    }
+
+    static bool is_macro_cell(const CellInfo *cell)
+    {
+        return cell->constr_parent != nullptr || !cell->constr_children.empty();
+    }
+
+    // All cells of the macro rooted at a cell, parents before children
+    static void get_macro_cells(CellInfo *root, std::vector<CellInfo *> &cells)
+    {
+        cells.push_back(root);
+        for (auto child : root->constr_children)
+            get_macro_cells(child, cells);
+    }
+
+    // Legalisation locks macros in place; those not constrained to an absolute location are unlocked again
+    // so that the annealer can move them as a unit
+    static void unlock_macro(CellInfo *root)
+    {
+        root->belStrength = STRENGTH_WEAK;
+        for (auto child : root->constr_children)
+            unlock_macro(child);
+    }
+
+    bool is_driver_port(const CellInfo *cell, const PortInfo &port) const
+    {
+        return port.net->driver.cell == cell && port.net->driver.port == port.name;
+    }
+
+    // A net touched by a detailed placement window, with everything that doesn't depend on where the window's
+    // cells go precomputed
+    struct WindowNet
+    {
+        // Bounding box of the pins outside the window, if there are any
+        bool has_static = false;
+        int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+        // Window cell indices of the pins inside the window
+        std::vector<int> window_pins;
+        // Criticality weighted arcs with at least one end in the window. An index of -1 means the pin is outside
+        // the window, at the given location
+        int driver_idx = -1;
+        Loc driver_loc;
+        struct Arc
+        {
+            int sink_idx;
+            Loc sink_loc;
+            float weight;
+        };
+        std::vector<Arc> arcs;
+    };
+
+    // A set of cells of the same type and the bels in a small area they may be permuted between
+    struct Window
+    {
+        std::vector<CellInfo *> cells;
+        std::vector<BelId> bels;
+        // The best assignments found (bel index for each cell), in order of increasing estimated cost
+        std::vector<std::vector<int>> candidates;
+    };
+
+    bool can_detail_move(const CellInfo *cell) const
+    {
+        return cell->belStrength <= STRENGTH_WEAK && !is_macro_cell(cell) &&
+               std::get<1>(bel_types.at(cell->type)) >= cfg.minBelsForGridPick;
+    }
+
+    // Split the grid into windows of window_tiles x window_tiles tiles, and pick the cells and bels that each one
+    // will permute. Odd passes offset the windows so that cells can cross window boundaries over time
+    std::vector<Window> setup_windows(int pass)
+    {
+        std::vector<Window> windows;
+        int offset = (pass % 2) ? window_tiles / 2 : 0;
+        for (int wx = -offset; wx <= max_x; wx += window_tiles) {
+            for (int wy = -offset; wy <= max_y; wy += window_tiles) {
+                std::map<IdString, std::vector<CellInfo *>> type_cells;
+                std::map<IdString, std::vector<BelId>> type_free;
+                for (int x = std::max(0, wx); x < std::min(max_x + 1, wx + window_tiles); x++) {
+                    for (int y = std::max(0, wy); y < std::min(max_y + 1, wy + window_tiles); y++) {
+                        for (auto bel : ctx->getBelsByTile(x, y)) {
+                            if (locked_bels.count(bel) || ctx->getBelGlobalBuf(bel))
+                                continue;
+                            CellInfo *bound = ctx->getBoundBelCell(bel);
+                            if (bound == nullptr) {
+                                type_free[ctx->getBelType(bel)].push_back(bel);
+                            } else if (can_detail_move(bound)) {
+                                type_cells[bound->type].push_back(bound);
+                            }
+                        }
+                    }
+                }
+                for (auto &tc : type_cells) {
+                    Window win;
+                    auto &cells = tc.second;
+                    ctx->shuffle(cells);
+                    if (int(cells.size()) > max_window_cells)
+                        cells.resize(max_window_cells);
+                    win.cells = cells;
+                    for (auto cell : cells)
+                        win.bels.push_back(cell->bel);
+                    auto &free = type_free[tc.first];
+                    ctx->shuffle(free);
+                    for (auto bel : free) {
+                        if (int(win.bels.size()) >= max_window_bels)
+                            break;
+                        win.bels.push_back(bel);
+                    }
+                    if (win.bels.size() < 2)
+                        continue;
+                    windows.push_back(std::move(win));
+                }
+            }
+        }
+        return windows;
+    }
+
+    // Find the best assignments of a window's cells to its bels by exhaustive search, using the same wirelength
+    // and timing cost as the annealer. Only reads the placement, so windows can be evaluated concurrently
+    void evaluate_window(Window &win) const
+    {
+        int n_cells = int(win.cells.size()), n_bels = int(win.bels.size());
+        std::vector<Loc> bel_locs;
+        for (auto bel : win.bels)
+            bel_locs.push_back(ctx->getBelLocation(bel));
+        auto window_idx = [&](const CellInfo *cell) -> int {
+            for (int i = 0; i < n_cells; i++)
+                if (win.cells.at(i) == cell)
+                    return i;
+            return -1;
+        };
+
+        std::vector<WindowNet> nets;
+        std::unordered_set<const NetInfo *> seen_nets;
+        for (auto cell : win.cells) {
+            for (auto &port : cell->ports) {
+                const NetInfo *ni = port.second.net;
+                if (ni == nullptr || seen_nets.count(ni))
+                    continue;
+                seen_nets.insert(ni);
+                const CellInfo *driver = ni->driver.cell;
+                if (driver == nullptr || driver->bel == BelId() || ctx->getBelGlobalBuf(driver->bel))
+                    continue;
+                WindowNet wn;
+                auto add_pin = [&](const CellInfo *pc) {
+                    int idx = window_idx(pc);
+                    if (idx != -1) {
+                        wn.window_pins.push_back(idx);
+                        return;
+                    }
+                    Loc loc = ctx->getBelLocation(pc->bel);
+                    if (!wn.has_static) {
+                        wn.x0 = wn.x1 = loc.x;
+                        wn.y0 = wn.y1 = loc.y;
+                        wn.has_static = true;
+                    } else {
+                        wn.x0 = std::min(wn.x0, loc.x);
+                        wn.x1 = std::max(wn.x1, loc.x);
+                        wn.y0 = std::min(wn.y0, loc.y);
+                        wn.y1 = std::max(wn.y1, loc.y);
+                    }
+                };
+                add_pin(driver);
+                wn.driver_idx = window_idx(driver);
+                wn.driver_loc = ctx->getBelLocation(driver->bel);
+                const float *weights = net_has_timing.at(ni->udata) ? arc_weight.data() + arc_offset.at(ni->udata)
+                                                                    : nullptr;
+                for (size_t i = 0; i < ni->users.size(); i++) {
+                    const CellInfo *load = ni->users.at(i).cell;
+                    if (load == nullptr || load->bel == BelId())
+                        continue;
+                    if (!ctx->getBelGlobalBuf(load->bel))
+                        add_pin(load);
+                    if (weights == nullptr || weights[i] == 0)
+                        continue;
+                    int sink_idx = window_idx(load);
+                    if (sink_idx == -1 && wn.driver_idx == -1)
+                        continue;
+                    wn.arcs.push_back(WindowNet::Arc{sink_idx, ctx->getBelLocation(load->bel), weights[i]});
+                }
+                nets.push_back(std::move(wn));
+            }
+        }
+
+        std::vector<int> assignment(n_cells);
+        std::vector<float> candidate_costs;
+        std::vector<bool> bel_used(n_bels, false);
+        auto assignment_cost = [&]() {
+            float cost = 0;
+            for (auto &wn : nets) {
+                int x0 = wn.x0, x1 = wn.x1, y0 = wn.y0, y1 = wn.y1;
+                bool init = wn.has_static;
+                for (int idx : wn.window_pins) {
+                    const Loc &loc = bel_locs.at(assignment.at(idx));
+                    if (!init) {
+                        x0 = x1 = loc.x;
+                        y0 = y1 = loc.y;
+                        init = true;
+                    } else {
+                        x0 = std::min(x0, loc.x);
+                        x1 = std::max(x1, loc.x);
+                        y0 = std::min(y0, loc.y);
+                        y1 = std::max(y1, loc.y);
+                    }
+                }
+                cost += (x1 - x0) + (y1 - y0);
+                if (wn.arcs.empty())
+                    continue;
+                const Loc &dl = wn.driver_idx == -1 ? wn.driver_loc : bel_locs.at(assignment.at(wn.driver_idx));
+                float timing_cost = 0;
+                for (auto &arc : wn.arcs) {
+                    const Loc &sl = arc.sink_idx == -1 ? arc.sink_loc : bel_locs.at(assignment.at(arc.sink_idx));
+                    timing_cost += arc.weight * (std::abs(sl.x - dl.x) + std::abs(sl.y - dl.y));
+                }
+                cost += cfg.timingWeight * timing_cost;
+            }
+            return cost;
+        };
+
+        // The current placement is the first n_cells bels in order
+        for (int i = 0; i < n_cells; i++)
+            assignment.at(i) = i;
+        float orig_cost = assignment_cost();
+
+        std::function<void(int)> search = [&](int i) {
+            if (i == n_cells) {
+                float cost = assignment_cost();
+                if (cost >= orig_cost - 1e-3)
+                    return;
+                size_t pos = std::upper_bound(candidate_costs.begin(), candidate_costs.end(), cost) -
+                             candidate_costs.begin();
+                if (pos >= size_t(max_window_candidates))
+                    return;
+                candidate_costs.insert(candidate_costs.begin() + pos, cost);
+                win.candidates.insert(win.candidates.begin() + pos, assignment);
+                if (candidate_costs.size() > size_t(max_window_candidates)) {
+                    candidate_costs.pop_back();
+                    win.candidates.pop_back();
+                }
+                return;
+            }
+            for (int j = 0; j < n_bels; j++) {
+                if (bel_used.at(j))
+                    continue;
+                bel_used.at(j) = true;
+                assignment.at(i) = j;
+                search(i + 1);
+                bel_used.at(j) = false;
+            }
+        };
+        search(0);
+    }
+
+    // Apply the best legal candidate assignment of a window that still improves the real cost, given the moves
+    // already made in other windows. Returns true if the placement was changed
+    bool commit_window(SwapWorker &w, const Window &win)
+    {
+        for (auto &cand : win.candidates) {
+            w.updates.clear();
+            w.moves.clear();
+            for (size_t i = 0; i < win.cells.size(); i++) {
+                CellInfo *cell = win.cells.at(i);
+                add_pin_moves(w, cell, cell->bel, win.bels.at(cand.at(i)));
+                ctx->unbindBel(cell->bel);
+            }
+            // Only the bels left free by the window's own cells may be used
+            bool legal = true;
+            for (size_t i = 0; i < win.cells.size(); i++) {
+                BelId bel = win.bels.at(cand.at(i));
+                if (!ctx->checkBelAvail(bel)) {
+                    legal = false;
+                    continue;
+                }
+                ctx->bindBel(bel, win.cells.at(i), STRENGTH_WEAK);
+            }
+            for (size_t i = 0; legal && i < win.cells.size(); i++)
+                if (!ctx->isBelLocationValid(win.bels.at(cand.at(i))) || !ctx->isBelLocationValid(win.bels.at(i)))
+                    legal = false;
+            if (legal) {
+                wirelen_t delta_wl = update_net_costs(w);
+                if (delta_wl + update_congestion(w) < 0) {
+                    curr_metric += delta_wl;
+                    commit_net_costs(w);
+                    return true;
+                }
+            }
+            revert_net_costs(w);
+            for (size_t i = 0; i < win.cells.size(); i++)
+                if (win.cells.at(i)->bel != BelId())
+                    ctx->unbindBel(win.cells.at(i)->bel);
+            for (size_t i = 0; i < win.cells.size(); i++)
+                ctx->bindBel(win.bels.at(i), win.cells.at(i), STRENGTH_WEAK);
+        }
+        return false;
+    }
+
+    // Detailed placement after annealing: optimally permute small groups of cells within windows of a few tiles.
+    // Windows are evaluated in parallel against a snapshot of the placement and then committed serially
+    void detailed_place()
+    {
+        auto dp_start = std::chrono::high_resolution_clock::now();
+        log_info("Running detailed placement.\n");
+        recompute_net_costs();
+        wirelen_t start_metric = curr_metric;
+        for (int pass = 0; pass < cfg.detailedPasses; pass++) {
+            std::vector<Window> windows = setup_windows(pass);
+            std::atomic<size_t> next_window(0);
+            auto worker = [&]() {
+                size_t idx;
+                while ((idx = next_window++) < windows.size())
+                    evaluate_window(windows.at(idx));
+            };
+            int n_threads = std::max(1, std::min(ctx->threads, int(windows.size())));
+            std::vector<std::thread> threads;
+            std::vector<std::exception_ptr> errors(n_threads);
+            for (int i = 0; i < n_threads; i++) {
+                threads.emplace_back([&worker, &errors, i]() {
+                    try {
+                        worker();
+                    } catch (...) {
+                        errors.at(i) = std::current_exception();
+                    }
+                });
+            }
+            for (auto &t : threads)
+                t.join();
+            for (auto &e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+
+            int n_improved = 0;
+            for (auto &win : windows)
+                if (!win.candidates.empty() && commit_window(serial_worker, win))
+                    n_improved++;
+            recompute_net_costs();
+            log_info("  pass %d: improved %d/%d windows, cost = %.0f\n", pass + 1, n_improved, int(windows.size()),
+                     double(curr_metric));
+            ctx->yield();
+        }
+        auto dp_end = std::chrono::high_resolution_clock::now();
+        log_info("Detailed placement reduced cost by %.02f%% in %.02fs\n",
+                 start_metric > 0 ? 100.0 * double(start_metric - curr_metric) / double(start_metric) : 0.0,
+                 std::chrono::duration<float>(dp_end - dp_start).count());
+    }
+
+    // Spatial index of the bels of one type that the annealer may move cells to. Types with too few bels for
+    // picking by location are collapsed onto a single 1x1 grid
+    struct BelIndex
+    {
+        int width = 1, height = 1;
+        // Bels at each location, indexed by x * height + y
+        std::vector<std::vector<BelId>> buckets;
+        // Number of bels with location <= (x - 1, y - 1), indexed by x * (height + 1) + y
+        std::vector<int> prefix;
+
+        int prefix_at(int x, int y) const { return prefix.at(x * (height + 1) + y); }
+
+        // Number of bels in the inclusive window [x0, x1] x [y0, y1]
+        int count(int x0, int y0, int x1, int y1) const
+        {
+            return prefix_at(x1 + 1, y1 + 1) - prefix_at(x0, y1 + 1) - prefix_at(x1 + 1, y0) + prefix_at(x0, y0);
+        }
+    };
+
+    // Build the per-type spatial indices, leaving out bels locked by user constraints
+    void build_bel_index()
+    {
+        bel_index.resize(bel_types.size());
+        for (auto &type : bel_types) {
+            auto &bi = bel_index.at(std::get<0>(type.second));
+            if (std::get<1>(type.second) >= cfg.minBelsForGridPick) {
+                bi.width = max_x + 1;
+                bi.height = max_y + 1;
+            }
+            bi.buckets.assign(bi.width * bi.height, std::vector<BelId>{});
+        }
+        for (auto bel : ctx->getBels()) {
+            if (locked_bels.count(bel))
+                continue;
+            auto &bi = bel_index.at(std::get<0>(bel_types.at(ctx->getBelType(bel))));
+            Loc loc = ctx->getBelLocation(bel);
+            if (bi.width == 1 && bi.height == 1)
+                loc.x = loc.y = 0;
+            bi.buckets.at(loc.x * bi.height + loc.y).push_back(bel);
+        }
+        for (auto &bi : bel_index) {
+            bi.prefix.assign((bi.width + 1) * (bi.height + 1), 0);
+            for (int x = 0; x < bi.width; x++)
+                for (int y = 0; y < bi.height; y++)
+                    bi.prefix.at((x + 1) * (bi.height + 1) + (y + 1)) =
+                            int(bi.buckets.at(x * bi.height + y).size()) + bi.prefix_at(x, y + 1) +
+                            bi.prefix_at(x + 1, y) - bi.prefix_at(x, y);
+        }
+    }
+
+    // Find a random Bel of the correct type for a cell, within the specified diameter and the worker's region.
+    // Every eligible bel in the window is equally likely; BelId() is returned if there are none
+    BelId random_bel_for_cell(SwapWorker &w, CellInfo *cell)
+    {
+        const auto &bi = bel_index.at(std::get<0>(bel_types.at(cell->type)));
+        int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+        if (bi.width > 1 || bi.height > 1) {
+            Loc curr_loc = ctx->getBelLocation(cell->bel);
+            x0 = std::max(curr_loc.x - diameter, w.x0);
+            x1 = std::min(curr_loc.x + diameter, w.x1);
+            y0 = std::max(curr_loc.y - diameter, w.y0);
+            y1 = std::min(curr_loc.y + diameter, w.y1);
+        }
+        int total = bi.count(x0, y0, x1, y1);
+        if (total == 0)
+            return BelId();
+        int k = w.rng->rng(total);
+        // Find the column containing the k-th bel of the window, then the row within that column
+        int lo = x0, hi = x1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (bi.count(x0, y0, mid, y1) > k)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        int x = lo;
+        k -= (x > x0) ? bi.count(x0, y0, x - 1, y1) : 0;
+        lo = y0;
+        hi = y1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (bi.count(x, y0, x, mid) > k)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        int y = lo;
+        k -= (y > y0) ? bi.count(x, y0, x, y - 1) : 0;
+        return bi.buckets.at(x * bi.height + y).at(k);
     }
 
     Context *ctx;
@@ -502,31 +1528,204 @@ class SAPlacer
     int n_move, n_accept;
     int diameter = 35, max_x = 1, max_y = 1;
     std::unordered_map<IdString, std::tuple<int, int>> bel_types;
-    std::vector<std::vector<std::vector<std::vector<BelId>>>> fast_bels;
+    std::vector<BelIndex> bel_index;
+    std::unique_ptr<CongestionMap> congestion;
+    // Nets with more sinks than this are left out of the congestion estimate, as they are expensive to update and
+    // are typically routed on dedicated resources
+    const int max_congestion_fanout = 64;
     std::unordered_set<BelId> locked_bels;
-    bool require_legal = true;
-    const float legalise_temp = 1;
-    const float post_legalise_temp = 10;
-    const float post_legalise_dia_scale = 1.5;
+    std::unordered_map<IdString, std::vector<BelId>> free_bels;
+    const int max_free_bel_tries = 100;
+    const float analytic_start_temp = 10;
+    // Detailed placement takes care of the small final improvements, so annealing can stop while still warmer
+    const float detailed_end_temp = 1e-2;
+    const int window_tiles = 2;
+    const int max_window_cells = 4;
+    const int max_window_bels = 8;
+    const int max_window_candidates = 3;
+    // Number of temperature steps over which the cost improvement is measured for convergence
+    const int convergence_window = 5;
+    std::deque<wirelen_t> metric_history;
+    const int analytic_start_dia = 8;
     Placer1Cfg cfg;
 
+    const int min_region_width = 8;
+    int n_regions = 1;
+    SwapWorker serial_worker;
+    std::vector<SwapWorker> region_workers;
+    // Region index of each cell/net (by udata) during a parallel pass, see run_parallel_moves
+    enum : int
+    {
+        REGION_NONE = -1,
+        REGION_STATIC = -2,
+        REGION_SHARED = -3
+    };
+    std::vector<int> cell_region, net_region;
+
     struct CostChange
     {
         wirelen_t curr_cost;
         wirelen_t new_cost;
     };
     std::vector<CostChange> costs;
+    std::vector<NetBounds> net_bounds, new_net_bounds;
+    // Cached timing weight (criticality ^ critExponent) of each arc, see refresh_criticalities
+    std::vector<size_t> arc_offset;
+    std::vector<float> arc_weight;
+    // Whether a net has any arcs with a non-zero weight
+    std::vector<char> net_has_timing;
+    // Arcs less critical than this don't contribute to the timing cost at all
+    const float min_arc_weight = 1e-3;
+    int64_t n_bounds_update = 0, n_bounds_fallback = 0;
+    double total_moves = 0;
     std::vector<decltype(NetInfo::udata)> old_udata;
+    std::vector<decltype(CellInfo::udata)> old_cell_udata;
 };
 
 Placer1Cfg::Placer1Cfg(Context *ctx) : Settings(ctx)
 {
     constraintWeight = get<float>("placer1/constraintWeight", 10);
     minBelsForGridPick = get<int>("placer1/minBelsForGridPick", 64);
+    analyticInit = get<bool>("placer1/analyticInit", false);
+    seeds = get<int>("placer1/seeds", 1);
+    // The effort level picks defaults for the schedule, which can still be overridden individually
+    std::string effort = get<std::string>("placer1/effort", "normal");
+    int default_moves;
+    float default_accept, default_improvement;
+    if (effort == "low") {
+        default_moves = 5;
+        default_accept = 0.05;
+        default_improvement = 0.005;
+    } else if (effort == "normal") {
+        // The original schedule, without early termination
+        default_moves = 15;
+        default_accept = 0;
+        default_improvement = 0;
+    } else if (effort == "high") {
+        default_moves = 40;
+        default_accept = 0;
+        default_improvement = 0;
+    } else {
+        log_error("Unknown placer effort level '%s' (expected low, normal or high)\n", effort.c_str());
+    }
+    movesPerTemp = get<int>("placer1/movesPerTemp", default_moves);
+    minAcceptRate = get<float>("placer1/minAcceptRate", default_accept);
+    minImprovement = get<float>("placer1/minImprovement", default_improvement);
+    timeLimit = get<float>("placer1/timeLimit", 0);
+    critRefreshIter = get<int>("placer1/critRefreshIter", 5);
+    if (critRefreshIter < 1)
+        log_error("placer1/critRefreshIter must be at least 1, got %d\n", critRefreshIter);
+    detailedPlace = get<bool>("placer1/detailedPlace", false);
+    detailedPasses = get<int>("placer1/detailedPasses", 4);
+    congestionWeight = get<float>("placer1/congestionWeight", 0);
+    congestionPipsPerNet = get<float>("placer1/congestionPipsPerNet", 32);
+    congestionCsv = get<std::string>("placer1/congestionCsv", "");
+    critExponent = get<float>("placer1/critExponent", 4);
+    timingWeight = get<float>("placer1/timingWeight", 3);
+}
+
+// Place copies of the design with different seeds in parallel, and keep the best result
+static bool placer1_multiseed(Context *ctx, Placer1Cfg cfg)
+{
+    struct SeedResult
+    {
+        std::unique_ptr<Context> ctx;
+        bool success = false;
+        delay_t worst_slack = 0;
+        wirelen_t wirelength = 0;
+        std::exception_ptr error;
+    };
+
+    int n = cfg.seeds;
+    log_break();
+    log_info("Running placer with %d seeds in parallel.\n", n);
+    auto startt = std::chrono::high_resolution_clock::now();
+    std::vector<SeedResult> results(n);
+    for (auto &res : results) {
+        res.ctx = ctx->cloneDesign();
+        res.ctx->rngseed(ctx->rng64());
+        // Share the available threads between the seeds
+        res.ctx->threads = std::max(1, ctx->threads / n);
+        res.ctx->settings[res.ctx->id("placer1/seeds")] = "1";
+    }
+
+    std::vector<std::thread> threads;
+    for (auto &res : results) {
+        SeedResult *r = &res;
+        threads.emplace_back([r]() {
+            log_thread_quiet = true;
+            try {
+                Context *sctx = r->ctx.get();
+                r->success = placer1(sctx, Placer1Cfg(sctx));
+                if (r->success) {
+                    if (sctx->timing_driven)
+                        r->worst_slack = get_worst_slack(sctx);
+                    for (auto &net : sctx->nets) {
+                        float tns;
+                        r->wirelength += get_net_metric(sctx, net.second.get(), MetricType::WIRELENGTH, tns);
+                    }
+                }
+            } catch (...) {
+                r->error = std::current_exception();
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    for (auto &res : results)
+        if (res.error)
+            std::rethrow_exception(res.error);
+
+    int best = -1;
+    for (int i = 0; i < n; i++) {
+        auto &res = results.at(i);
+        if (!res.success) {
+            log_info("  seed #%d: placement failed\n", i + 1);
+            continue;
+        }
+        log_info("  seed #%d: worst slack %.02fns, wirelength %lld\n", i + 1,
+                 res.ctx->getDelayNS(res.worst_slack), (long long)res.wirelength);
+        if (best == -1 || res.worst_slack > results.at(best).worst_slack ||
+            (res.worst_slack == results.at(best).worst_slack && res.wirelength < results.at(best).wirelength))
+            best = i;
+    }
+    auto endt = std::chrono::high_resolution_clock::now();
+    log_info("Multi-seed placement time %.02fs\n", std::chrono::duration<float>(endt - startt).count());
+    if (best == -1) {
+        log_nonfatal_error("placement failed for all seeds\n");
+        return false;
+    }
+    log_info("Using placement from seed #%d.\n", best + 1);
+
+    // Copy the winning placement back to the original design
+    const Context *bctx = results.at(best).ctx.get();
+    ctx->lock();
+    for (auto &cell : ctx->cells)
+        if (cell.second->bel != BelId())
+            ctx->unbindBel(cell.second->bel);
+    for (auto &cell : ctx->cells) {
+        CellInfo *ci = cell.second.get();
+        const CellInfo *bci = bctx->cells.at(cell.first).get();
+        if (bci->bel == BelId())
+            continue;
+        ctx->bindBel(bci->bel, ci, bci->belStrength);
+        ci->attrs[ctx->id("BEL")] = ctx->getBelName(bci->bel).str(ctx);
+    }
+    for (auto &net : ctx->nets) {
+        const NetInfo *bni = bctx->nets.at(net.first).get();
+        for (size_t i = 0; i < net.second->users.size(); i++)
+            net.second->users.at(i).budget = bni->users.at(i).budget;
+    }
+    timing_analysis(ctx);
+    ctx->unlock();
+    log_info("Checksum: 0x%08x\n", ctx->checksum());
+    return true;
 }
 
 bool placer1(Context *ctx, Placer1Cfg cfg)
 {
+    if (cfg.seeds > 1)
+        return placer1_multiseed(ctx, cfg);
     try {
         SAPlacer placer(ctx, cfg);
         placer.place();
@@ -29,6 +29,30 @@ struct Placer1Cfg : public Settings
     Placer1Cfg(Context *ctx);
     float constraintWeight;
     int minBelsForGridPick;
+    bool analyticInit;
+    int seeds;
+    // Number of passes over all movable cells per temperature step
+    int movesPerTemp;
+    // Annealing ends early once the acceptance rate drops below minAcceptRate and the cost improved by less
+    // than minImprovement (as a fraction) over the last few temperature steps. Zero disables this
+    float minAcceptRate;
+    float minImprovement;
+    // Wall-clock limit for annealing in seconds, zero for no limit
+    float timeLimit;
+    // Number of temperature steps between updates of the cached arc criticalities
+    int critRefreshIter;
+    // Timing cost of an arc is its length times criticality ^ critExponent, scaled by timingWeight
+    float critExponent;
+    float timingWeight;
+    // Run window-based detailed placement after annealing, with this many passes over the grid
+    bool detailedPlace;
+    int detailedPasses;
+    // Weight of the routing overflow estimated by the RUDY congestion map, zero to disable
+    float congestionWeight;
+    // Number of pips in a tile taken to support one unit of RUDY demand
+    float congestionPipsPerNet;
+    // If set, the final congestion map is written to this CSV file
+    std::string congestionCsv;
 };
 
 extern bool placer1(Context *ctx, Placer1Cfg cfg);
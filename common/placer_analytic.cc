@@ -0,0 +1,644 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Analytic global placer, used to create a starting point for the annealer
+ *
+ * Each iteration solves the quadratic (clique model) wirelength minimisation problem in x and y
+ * separately, using a Jacobi-preconditioned conjugate gradient solver. The solution is then spread
+ * over the free bels of each type by recursive bisection, which also gives a legal assignment of cells
+ * to bels. In later iterations cells are pulled towards their spread location by pseudo-connections
+ * of increasing weight, so that solution and spread placement converge (similar to SimPL).
+ *
+ * Relative placement macros, such as carry chains, are modelled as one object at the location of their root cell,
+ * with the pins of the other cells at their constraint offset from it. They are spread and bound as a unit, so
+ * that the relative constraint legaliser doesn't need to move them.
+ */
+
+#include "placer_analytic.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "log.h"
+#include "util.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+namespace {
+
+// Sparse symmetric matrix, stored in compressed row form
+struct SparseMatrix
+{
+    int n = 0;
+    std::vector<int> row_start, col;
+    std::vector<double> value, diag;
+
+    // Build from a list of (row, col, value) entries, summing duplicates
+    void build(int size, std::vector<std::tuple<int, int, double>> &entries)
+    {
+        n = size;
+        std::sort(entries.begin(), entries.end(), [](const std::tuple<int, int, double> &a,
+                                                     const std::tuple<int, int, double> &b) {
+            return std::make_pair(std::get<0>(a), std::get<1>(a)) < std::make_pair(std::get<0>(b), std::get<1>(b));
+        });
+        row_start.assign(n + 1, 0);
+        col.clear();
+        value.clear();
+        diag.assign(n, 0);
+        int last_row = -1, last_col = -1;
+        for (auto &entry : entries) {
+            int r, c;
+            double v;
+            std::tie(r, c, v) = entry;
+            if (r == last_row && c == last_col) {
+                value.back() += v;
+            } else {
+                col.push_back(c);
+                value.push_back(v);
+                row_start.at(r + 1)++;
+                last_row = r;
+                last_col = c;
+            }
+            if (r == c)
+                diag.at(r) += v;
+        }
+        for (int i = 0; i < n; i++)
+            row_start.at(i + 1) += row_start.at(i);
+    }
+
+    void multiply(const std::vector<double> &x, std::vector<double> &y) const
+    {
+        for (int i = 0; i < n; i++) {
+            double sum = 0;
+            for (int j = row_start[i]; j < row_start[i + 1]; j++)
+                sum += value[j] * x[col[j]];
+            y[i] = sum;
+        }
+    }
+};
+
+double dot(const std::vector<double> &a, const std::vector<double> &b)
+{
+    double sum = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+// Solve Ax = b using the preconditioned conjugate gradient method, x is used as the starting point
+void solve_cg(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x, int max_iters, double tol)
+{
+    int n = A.n;
+    std::vector<double> r(n), z(n), p(n), Ap(n);
+    A.multiply(x, Ap);
+    for (int i = 0; i < n; i++) {
+        r[i] = b[i] - Ap[i];
+        z[i] = r[i] / A.diag[i];
+        p[i] = z[i];
+    }
+    double rz = dot(r, z);
+    double b_norm = std::sqrt(dot(b, b));
+    if (b_norm == 0)
+        b_norm = 1;
+    for (int iter = 0; iter < max_iters; iter++) {
+        if (std::sqrt(dot(r, r)) <= tol * b_norm)
+            break;
+        A.multiply(p, Ap);
+        double alpha = rz / dot(p, Ap);
+        for (int i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            z[i] = r[i] / A.diag[i];
+        }
+        double rz_new = dot(r, z);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        for (int i = 0; i < n; i++)
+            p[i] = z[i] + beta * p[i];
+    }
+}
+
+} // namespace
+
+class AnalyticPlacer
+{
+  public:
+    AnalyticPlacer(Context *ctx, AnalyticPlacerCfg cfg, const std::vector<CellInfo *> &cells)
+            : ctx(ctx), cfg(cfg), cells(cells)
+    {
+        std::unordered_set<IdString> to_place;
+        for (auto ci : cells)
+            to_place.insert(ci->name);
+        for (auto ci : cells) {
+            if (ci->constr_parent != nullptr)
+                continue;
+            // Macros with an absolute location, or with some cells already placed, are left to the legaliser
+            if (ci->constr_x != ci->UNCONSTR || ci->constr_y != ci->UNCONSTR)
+                continue;
+            Object obj;
+            add_macro_cell(obj, ci, -1, 0, 0);
+            if (std::any_of(obj.members.begin(), obj.members.end(),
+                            [&](const MacroCell &m) { return !to_place.count(m.cell->name); }))
+                continue;
+            for (int i = 0; i < int(obj.members.size()); i++) {
+                const MacroCell &m = obj.members.at(i);
+                cell_pin[m.cell->name] = std::make_pair(int(objects.size()), i);
+                obj.min_dx = std::min(obj.min_dx, m.dx);
+                obj.max_dx = std::max(obj.max_dx, m.dx);
+                obj.min_dy = std::min(obj.min_dy, m.dy);
+                obj.max_dy = std::max(obj.max_dy, m.dy);
+            }
+            objects.push_back(std::move(obj));
+        }
+        for (auto bel : ctx->getBels()) {
+            Loc loc = ctx->getBelLocation(bel);
+            max_x = std::max(max_x, loc.x);
+            max_y = std::max(max_y, loc.y);
+            if (ctx->checkBelAvail(bel))
+                free_bels[ctx->getBelType(bel)].push_back(bel);
+        }
+        for (auto &type : free_bels) {
+            auto &grid = bel_grid[type.first];
+            grid.resize((max_x + 1) * (max_y + 1));
+            for (auto bel : type.second) {
+                Loc loc = ctx->getBelLocation(bel);
+                grid.at(loc.y * (max_x + 1) + loc.x).push_back(bel);
+            }
+        }
+        pos_x.assign(objects.size(), max_x / 2.0);
+        pos_y.assign(objects.size(), max_y / 2.0);
+        spread_x = pos_x;
+        spread_y = pos_y;
+    }
+
+    bool place()
+    {
+        auto startt = std::chrono::high_resolution_clock::now();
+        build_nets();
+        log_info("Running analytic placer on %d cells (%d objects) and %d nets.\n", int(cell_pin.size()),
+                 int(objects.size()), int(nets.size()));
+        for (int iter = 0; iter < cfg.iterations; iter++) {
+            solve(iter);
+            double solved_hpwl = total_hpwl(pos_x, pos_y);
+            spread();
+            double spread_hpwl = total_hpwl(spread_x, spread_y);
+            log_info("  at analytic iteration #%d: solved HPWL = %.0f, spread HPWL = %.0f\n", iter + 1, solved_hpwl,
+                     spread_hpwl);
+            ctx->yield();
+        }
+        int placed = bind_cells();
+        auto endt = std::chrono::high_resolution_clock::now();
+        log_info("Analytic placer placed %d/%d cells.\n", placed, int(cells.size()));
+        log_info("Analytic placement time %.02fs\n", std::chrono::duration<float>(endt - startt).count());
+        return true;
+    }
+
+  private:
+    // A cell of a movable object, at an offset from the object's root. For relative constraints on z, parent is
+    // the index of the cell's constraint parent within the object (-1 for the root)
+    struct MacroCell
+    {
+        CellInfo *cell;
+        int parent;
+        int dx, dy;
+    };
+
+    // A single cell, or a whole relative placement macro, which is moved as one unit at the root's location
+    struct Object
+    {
+        std::vector<MacroCell> members;
+        int min_dx = 0, max_dx = 0, min_dy = 0, max_dy = 0;
+    };
+
+    // A pin on a movable object
+    struct Pin
+    {
+        int obj;
+        int dx, dy;
+
+        bool operator==(const Pin &other) const { return obj == other.obj && dx == other.dx && dy == other.dy; }
+    };
+
+    // A net as seen by the wirelength model
+    struct AnalyticNet
+    {
+        std::vector<Pin> movable;
+        std::vector<Loc> fixed;
+        double weight;
+    };
+
+    void add_macro_cell(Object &obj, CellInfo *ci, int parent, int dx, int dy)
+    {
+        int idx = int(obj.members.size());
+        obj.members.push_back(MacroCell{ci, parent, dx, dy});
+        for (auto child : ci->constr_children)
+            add_macro_cell(obj, child, idx, dx + (child->constr_x == child->UNCONSTR ? 0 : child->constr_x),
+                           dy + (child->constr_y == child->UNCONSTR ? 0 : child->constr_y));
+    }
+
+    void build_nets()
+    {
+        for (auto net : sorted(ctx->nets)) {
+            NetInfo *ni = net.second;
+            CellInfo *driver = ni->driver.cell;
+            if (driver == nullptr || int(ni->users.size()) + 1 > cfg.maxNetSize)
+                continue;
+            // Globally routed nets don't contribute to wirelength
+            if (driver->bel != BelId() && ctx->getBelGlobalBuf(driver->bel))
+                continue;
+            AnalyticNet an;
+            auto add_pin = [&](const CellInfo *ci) {
+                if (ci == nullptr)
+                    return;
+                auto fnd = cell_pin.find(ci->name);
+                if (fnd != cell_pin.end()) {
+                    const MacroCell &m = objects.at(fnd->second.first).members.at(fnd->second.second);
+                    Pin pin{fnd->second.first, m.dx, m.dy};
+                    if (std::find(an.movable.begin(), an.movable.end(), pin) == an.movable.end())
+                        an.movable.push_back(pin);
+                } else if (ci->bel != BelId()) {
+                    an.fixed.push_back(ctx->getBelLocation(ci->bel));
+                }
+            };
+            add_pin(driver);
+            for (auto &usr : ni->users)
+                add_pin(usr.cell);
+            int pins = int(an.movable.size() + an.fixed.size());
+            if (an.movable.empty() || pins < 2)
+                continue;
+            an.weight = 1.0 / (pins - 1);
+            nets.push_back(an);
+        }
+    }
+
+    // Solve for the wirelength-optimal location of all objects, pulled towards the spread location
+    // found in the previous iteration. A pin at offset o from its object's root adds o to the root's position
+    void solve(int iter)
+    {
+        int n = int(objects.size());
+        for (int axis = 0; axis < 2; axis++) {
+            auto &pos = axis ? pos_y : pos_x;
+            auto &spread = axis ? spread_y : spread_x;
+            double max_pos = axis ? max_y : max_x;
+            std::vector<std::tuple<int, int, double>> entries;
+            std::vector<double> rhs(n, 0);
+            for (auto &an : nets) {
+                double w = an.weight;
+                for (size_t i = 0; i < an.movable.size(); i++) {
+                    int a = an.movable.at(i).obj;
+                    double oa = axis ? an.movable.at(i).dy : an.movable.at(i).dx;
+                    for (size_t j = i + 1; j < an.movable.size(); j++) {
+                        int b = an.movable.at(j).obj;
+                        double ob = axis ? an.movable.at(j).dy : an.movable.at(j).dx;
+                        // Pins on the same object are a constant distance apart
+                        if (a == b)
+                            continue;
+                        entries.emplace_back(a, a, w);
+                        entries.emplace_back(b, b, w);
+                        entries.emplace_back(a, b, -w);
+                        entries.emplace_back(b, a, -w);
+                        rhs.at(a) += w * (ob - oa);
+                        rhs.at(b) += w * (oa - ob);
+                    }
+                    for (auto &f : an.fixed) {
+                        entries.emplace_back(a, a, w);
+                        rhs.at(a) += w * ((axis ? f.y : f.x) - oa);
+                    }
+                }
+            }
+            double anchor_weight = cfg.anchorWeight * iter;
+            for (int i = 0; i < n; i++) {
+                // A weak pull to the centre of the device keeps the system well-defined for groups
+                // of cells not connected to anything fixed
+                entries.emplace_back(i, i, centre_weight);
+                rhs.at(i) += centre_weight * (max_pos / 2.0);
+                if (iter > 0) {
+                    entries.emplace_back(i, i, anchor_weight);
+                    rhs.at(i) += anchor_weight * spread.at(i);
+                }
+            }
+            SparseMatrix A;
+            A.build(n, entries);
+            solve_cg(A, rhs, pos, max_cg_iters, cg_tolerance);
+            for (int i = 0; i < n; i++) {
+                const Object &obj = objects.at(i);
+                double lo = -(axis ? obj.min_dy : obj.min_dx), hi = max_pos - (axis ? obj.max_dy : obj.max_dx);
+                pos.at(i) = std::min(std::max(pos.at(i), lo), std::max(lo, hi));
+            }
+        }
+    }
+
+    // Find bels for all cells of an object with its root in tile (x, y), using only free bels accepted by usable.
+    // Cells with a z constraint must be at that z, others take the first usable bel in their tile
+    template <typename F> bool fit_object(const Object &obj, int x, int y, F usable, std::vector<BelId> &bels)
+    {
+        bels.clear();
+        std::vector<int> zs;
+        for (auto &m : obj.members) {
+            int tx = x + m.dx, ty = y + m.dy;
+            if (tx < 0 || tx > max_x || ty < 0 || ty > max_y)
+                return false;
+            auto fnd = bel_grid.find(m.cell->type);
+            if (fnd == bel_grid.end())
+                return false;
+            int z = m.cell->UNCONSTR;
+            if (m.cell->constr_z != m.cell->UNCONSTR)
+                z = (m.parent == -1 || m.cell->constr_abs_z) ? m.cell->constr_z
+                                                             : zs.at(m.parent) + m.cell->constr_z;
+            BelId found;
+            for (auto cand : fnd->second.at(ty * (max_x + 1) + tx)) {
+                if (z != m.cell->UNCONSTR && ctx->getBelLocation(cand).z != z)
+                    continue;
+                if (std::find(bels.begin(), bels.end(), cand) != bels.end() || !usable(m.cell, cand))
+                    continue;
+                found = cand;
+                break;
+            }
+            if (found == BelId())
+                return false;
+            bels.push_back(found);
+            zs.push_back(ctx->getBelLocation(found).z);
+        }
+        return true;
+    }
+
+    // Search rings of tiles of increasing distance around (x, y) for a root location at which the whole object
+    // fits, returning the bels for the closest one in the first ring that has any
+    template <typename F>
+    bool fit_object_near(const Object &obj, double x, double y, F usable, std::vector<BelId> &bels)
+    {
+        int cx = std::min(std::max(int(std::lround(x)), 0), max_x);
+        int cy = std::min(std::max(int(std::lround(y)), 0), max_y);
+        std::vector<BelId> cand_bels;
+        for (int r = 0; r <= std::max(max_x, max_y); r++) {
+            double best_dist = std::numeric_limits<double>::max();
+            for (int ty = std::max(cy - r, 0); ty <= std::min(cy + r, max_y); ty++) {
+                // Whole rows at the top and bottom of the ring, only its two ends in between
+                int step = (ty == cy - r || ty == cy + r) ? 1 : 2 * r;
+                for (int tx = cx - r; tx <= cx + r; tx += step) {
+                    if (tx < 0 || tx > max_x)
+                        continue;
+                    double dx = tx - x, dy = ty - y;
+                    double dist = dx * dx + dy * dy;
+                    if (dist < best_dist && fit_object(obj, tx, ty, usable, cand_bels)) {
+                        best_dist = dist;
+                        bels = cand_bels;
+                    }
+                }
+            }
+            if (best_dist != std::numeric_limits<double>::max())
+                return true;
+        }
+        return false;
+    }
+
+    // Assign objects to free bels of the correct type, staying as close as possible to the solved
+    // positions while not exceeding the available capacity anywhere. Macros are fitted first, each
+    // as a unit at the nearest location where all its cells fit, then single cells are spread over
+    // the remaining bels
+    void spread()
+    {
+        assigned.assign(objects.size(), std::vector<BelId>());
+        std::vector<int> macros;
+        for (int i = 0; i < int(objects.size()); i++)
+            if (objects.at(i).members.size() > 1)
+                macros.push_back(i);
+        std::stable_sort(macros.begin(), macros.end(), [&](int a, int b) {
+            return objects.at(a).members.size() > objects.at(b).members.size();
+        });
+        std::unordered_set<BelId> reserved;
+        for (int i : macros) {
+            auto &bels = assigned.at(i);
+            if (!fit_object_near(objects.at(i), pos_x.at(i), pos_y.at(i),
+                                 [&](const CellInfo *, BelId bel) { return !reserved.count(bel); }, bels))
+                continue;
+            for (auto bel : bels)
+                reserved.insert(bel);
+        }
+
+        std::unordered_map<IdString, std::vector<int>> objects_by_type;
+        for (int i = 0; i < int(objects.size()); i++)
+            if (objects.at(i).members.size() == 1)
+                objects_by_type[objects.at(i).members.front().cell->type].push_back(i);
+        for (auto &type : objects_by_type) {
+            auto fnd = free_bels.find(type.first);
+            if (fnd == free_bels.end())
+                continue;
+            std::vector<BelId> bels;
+            for (auto bel : fnd->second)
+                if (!reserved.count(bel))
+                    bels.push_back(bel);
+            auto &type_objects = type.second;
+            // Any overflow is left for the caller to report
+            if (type_objects.size() > bels.size())
+                type_objects.resize(bels.size());
+            bisect(type_objects.begin(), type_objects.end(), bels.begin(), bels.end());
+        }
+        for (int i = 0; i < int(objects.size()); i++) {
+            if (assigned.at(i).empty()) {
+                spread_x.at(i) = pos_x.at(i);
+                spread_y.at(i) = pos_y.at(i);
+            } else {
+                // The root is always the first cell of an object, at offset zero
+                Loc loc = ctx->getBelLocation(assigned.at(i).front());
+                spread_x.at(i) = loc.x;
+                spread_y.at(i) = loc.y;
+            }
+        }
+    }
+
+    void bisect(std::vector<int>::iterator c0, std::vector<int>::iterator c1, std::vector<BelId>::iterator b0,
+                std::vector<BelId>::iterator b1)
+    {
+        int nc = int(c1 - c0), nb = int(b1 - b0);
+        if (nc == 0)
+            return;
+        NPNR_ASSERT(nb >= nc);
+        if (nc == 1) {
+            // Pick the closest bel in the region
+            int ci = *c0;
+            double best_dist = std::numeric_limits<double>::max();
+            for (auto it = b0; it != b1; ++it) {
+                Loc loc = ctx->getBelLocation(*it);
+                double dx = loc.x - pos_x.at(ci), dy = loc.y - pos_y.at(ci);
+                double dist = dx * dx + dy * dy;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    assigned.at(ci).assign(1, *it);
+                }
+            }
+            return;
+        }
+
+        int xmin = std::numeric_limits<int>::max(), xmax = std::numeric_limits<int>::min();
+        int ymin = std::numeric_limits<int>::max(), ymax = std::numeric_limits<int>::min();
+        for (auto it = b0; it != b1; ++it) {
+            Loc loc = ctx->getBelLocation(*it);
+            xmin = std::min(xmin, loc.x);
+            xmax = std::max(xmax, loc.x);
+            ymin = std::min(ymin, loc.y);
+            ymax = std::max(ymax, loc.y);
+        }
+        if (xmin == xmax && ymin == ymax) {
+            // All bels are in the same tile, so any assignment is as good as another
+            for (int i = 0; i < nc; i++)
+                assigned.at(c0[i]).assign(1, b0[i]);
+            return;
+        }
+
+        // Cut across the longer side of the region, with half the bels on each side
+        bool cut_x = (xmax - xmin) >= (ymax - ymin);
+        auto bel_key = [&](BelId bel) {
+            Loc loc = ctx->getBelLocation(bel);
+            return cut_x ? std::make_tuple(loc.x, loc.y, loc.z) : std::make_tuple(loc.y, loc.x, loc.z);
+        };
+        std::sort(b0, b1, [&](BelId a, BelId b) { return bel_key(a) < bel_key(b); });
+        int nb_left = nb / 2, nb_right = nb - nb_left;
+        double cut = (std::get<0>(bel_key(b0[nb_left - 1])) + std::get<0>(bel_key(b0[nb_left]))) / 2.0;
+
+        auto cell_pos = [&](int i) { return cut_x ? pos_x.at(i) : pos_y.at(i); };
+        std::sort(c0, c1, [&](int a, int b) {
+            return std::make_pair(cell_pos(a), a) < std::make_pair(cell_pos(b), b);
+        });
+        int nc_left = int(std::partition_point(c0, c1, [&](int i) { return cell_pos(i) < cut; }) - c0);
+        // Move cells across the cut where one side would be overfull
+        nc_left = std::min(nc_left, nb_left);
+        nc_left = std::max(nc_left, nc - nb_right);
+
+        bisect(c0, c0 + nc_left, b0, b0 + nb_left);
+        bisect(c0 + nc_left, c1, b0 + nb_left, b1);
+    }
+
+    // Bind all cells of an object to the given bels, or none of them if the architecture rejects any
+    bool bind_object(const Object &obj, const std::vector<BelId> &bels)
+    {
+        for (int i = 0; i < int(obj.members.size()); i++) {
+            CellInfo *ci = obj.members.at(i).cell;
+            BelId bel = bels.at(i);
+            if (!ctx->checkBelAvail(bel) || !ctx->isValidBelForCell(ci, bel)) {
+                for (int j = 0; j < i; j++)
+                    ctx->unbindBel(bels.at(j));
+                return false;
+            }
+            ctx->bindBel(bel, ci, STRENGTH_WEAK);
+        }
+        for (int i = 0; i < int(obj.members.size()); i++) {
+            // Back annotate location
+            obj.members.at(i).cell->attrs[ctx->id("BEL")] = ctx->getBelName(bels.at(i)).str(ctx);
+        }
+        return true;
+    }
+
+    // Bind objects to their spread location, falling back to the nearest valid free location where the
+    // architecture rejects the assigned one (e.g. due to incompatible cells sharing a tile). Macros go first
+    // as they are the hardest to fit
+    int bind_cells()
+    {
+        int placed = 0;
+        std::vector<int> order;
+        for (int i = 0; i < int(objects.size()); i++)
+            order.push_back(i);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return objects.at(a).members.size() > objects.at(b).members.size();
+        });
+        auto live_usable = [&](CellInfo *ci, BelId bel) {
+            return ctx->checkBelAvail(bel) && ctx->isValidBelForCell(ci, bel);
+        };
+        std::vector<BelId> bels;
+        for (int i : order) {
+            const Object &obj = objects.at(i);
+            if (assigned.at(i).empty())
+                continue;
+            if (!bind_object(obj, assigned.at(i))) {
+                if (!fit_object_near(obj, spread_x.at(i), spread_y.at(i), live_usable, bels) ||
+                    !bind_object(obj, bels))
+                    continue;
+            }
+            placed += int(obj.members.size());
+        }
+        return placed;
+    }
+
+    double total_hpwl(const std::vector<double> &x, const std::vector<double> &y) const
+    {
+        double hpwl = 0;
+        for (auto &an : nets) {
+            double x0 = std::numeric_limits<double>::max(), x1 = std::numeric_limits<double>::lowest();
+            double y0 = x0, y1 = x1;
+            for (auto &p : an.movable) {
+                x0 = std::min(x0, x.at(p.obj) + p.dx);
+                x1 = std::max(x1, x.at(p.obj) + p.dx);
+                y0 = std::min(y0, y.at(p.obj) + p.dy);
+                y1 = std::max(y1, y.at(p.obj) + p.dy);
+            }
+            for (auto &f : an.fixed) {
+                x0 = std::min(x0, double(f.x));
+                x1 = std::max(x1, double(f.x));
+                y0 = std::min(y0, double(f.y));
+                y1 = std::max(y1, double(f.y));
+            }
+            hpwl += (x1 - x0) + (y1 - y0);
+        }
+        return hpwl;
+    }
+
+    Context *ctx;
+    AnalyticPlacerCfg cfg;
+    std::vector<CellInfo *> cells;
+    std::vector<Object> objects;
+    // Object index and member index of each cell being placed
+    std::unordered_map<IdString, std::pair<int, int>> cell_pin;
+    std::unordered_map<IdString, std::vector<BelId>> free_bels;
+    // Free bels of each type by tile, indexed by y * (max_x + 1) + x
+    std::unordered_map<IdString, std::vector<std::vector<BelId>>> bel_grid;
+    std::vector<AnalyticNet> nets;
+    int max_x = 0, max_y = 0;
+    // Solved and spread locations of the root of each object
+    std::vector<double> pos_x, pos_y, spread_x, spread_y;
+    // Bels assigned to the cells of each object by the last spreading pass, empty if it didn't fit
+    std::vector<std::vector<BelId>> assigned;
+
+    const double centre_weight = 1e-4;
+    const int max_cg_iters = 100;
+    const double cg_tolerance = 1e-5;
+};
+
+AnalyticPlacerCfg::AnalyticPlacerCfg(Context *ctx) : Settings(ctx)
+{
+    iterations = get<int>("placer_analytic/iterations", 8);
+    maxNetSize = get<int>("placer_analytic/maxNetSize", 64);
+    anchorWeight = get<float>("placer_analytic/anchorWeight", 0.05);
+}
+
+bool placer_analytic(Context *ctx, AnalyticPlacerCfg cfg, const std::vector<CellInfo *> &cells)
+{
+    try {
+        AnalyticPlacer placer(ctx, cfg, cells);
+        return placer.place();
+    } catch (log_execution_error_exception) {
+        return false;
+    }
+}
+
+NEXTPNR_NAMESPACE_END
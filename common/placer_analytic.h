@@ -0,0 +1,46 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef PLACER_ANALYTIC_H
+#define PLACER_ANALYTIC_H
+
+#include "nextpnr.h"
+#include "settings.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+struct AnalyticPlacerCfg : public Settings
+{
+    AnalyticPlacerCfg(Context *ctx);
+    // Number of solve/spread iterations
+    int iterations;
+    // Nets with more pins than this are ignored by the wirelength model
+    int maxNetSize;
+    // Weight of the pseudo-connections to the spread location, multiplied by the iteration number
+    float anchorWeight;
+};
+
+// Place the given (currently unplaced) cells close to the optimum of a quadratic wirelength model,
+// using recursive bisection over the free bels of each type for spreading and legalisation. Cells
+// that cannot be legally placed this way are left unplaced for the caller to deal with.
+extern bool placer_analytic(Context *ctx, AnalyticPlacerCfg cfg, const std::vector<CellInfo *> &cells);
+
+NEXTPNR_NAMESPACE_END
+
+#endif // PLACER_ANALYTIC_H
@@ -0,0 +1,240 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * The routing file is line based, one block per routed net:
+ *
+ *   chip <chip name>
+ *   net <driver bel> <driver port> <net name>
+ *   sink <bel> <port>
+ *   wire <wire name>
+ *   pip <src wire name> <dst wire name>
+ *   end
+ *
+ * "wire" lines are wires bound without a pip (the source of the net), "pip" lines are pips bound together with their
+ * destination wire. The net name is the rest of the line, so it may contain spaces.
+ */
+
+#include "route_eco.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include "log.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+namespace {
+
+std::string endpoint_bel(const Context *ctx, const PortRef &port)
+{
+    if (port.cell == nullptr || port.cell->bel == BelId())
+        return "-";
+    return ctx->getBelName(port.cell->bel).str(ctx);
+}
+
+struct SavedNet
+{
+    std::string name;
+    std::string driver_bel, driver_port;
+    std::vector<std::pair<std::string, std::string>> sinks;
+    std::vector<std::string> wires;
+    std::vector<std::pair<std::string, std::string>> pips;
+};
+
+PipId find_pip(const Context *ctx, WireId src, WireId dst)
+{
+    for (auto pip : ctx->getPipsDownhill(src))
+        if (ctx->getPipDstWire(pip) == dst)
+            return pip;
+    return PipId();
+}
+
+// Resolve and bind the saved routing of one net. Returns false, binding nothing, if any of it is missing from the
+// chip or already used by another net
+bool restore_net(Context *ctx, NetInfo *net, const SavedNet &saved)
+{
+    std::vector<WireId> wires;
+    std::vector<PipId> pips;
+    std::unordered_set<WireId> dst_wires;
+
+    for (auto &name : saved.wires) {
+        WireId wire = ctx->getWireByName(ctx->id(name));
+        if (wire == WireId() || !ctx->checkWireAvail(wire) || !dst_wires.insert(wire).second)
+            return false;
+        wires.push_back(wire);
+    }
+
+    for (auto &names : saved.pips) {
+        WireId src = ctx->getWireByName(ctx->id(names.first));
+        WireId dst = ctx->getWireByName(ctx->id(names.second));
+        if (src == WireId() || dst == WireId())
+            return false;
+        PipId pip = find_pip(ctx, src, dst);
+        if (pip == PipId() || !ctx->checkPipAvail(pip) || !ctx->checkWireAvail(dst) || !dst_wires.insert(dst).second)
+            return false;
+        pips.push_back(pip);
+    }
+
+    for (auto wire : wires)
+        ctx->bindWire(wire, net, STRENGTH_STRONG);
+    for (auto pip : pips)
+        ctx->bindPip(pip, net, STRENGTH_STRONG);
+    return true;
+}
+
+} // namespace
+
+void write_routing(Context *ctx, const std::string &filename)
+{
+    std::ofstream f(filename);
+    if (!f)
+        log_error("Failed to open routing file '%s' for writing\n", filename.c_str());
+
+    std::vector<NetInfo *> nets;
+    for (auto &net : ctx->nets)
+        if (net.second->driver.cell != nullptr && !net.second->wires.empty())
+            nets.push_back(net.second.get());
+    std::sort(nets.begin(), nets.end(),
+              [&](const NetInfo *a, const NetInfo *b) { return a->name.str(ctx) < b->name.str(ctx); });
+
+    f << "chip " << ctx->getChipName() << std::endl;
+    for (auto net : nets) {
+        f << "net " << endpoint_bel(ctx, net->driver) << " " << net->driver.port.str(ctx) << " " << net->name.str(ctx)
+          << std::endl;
+        for (auto &user : net->users)
+            f << "sink " << endpoint_bel(ctx, user) << " " << user.port.str(ctx) << std::endl;
+
+        std::vector<std::pair<std::string, PipId>> wires;
+        for (auto &it : net->wires)
+            wires.emplace_back(ctx->getWireName(it.first).str(ctx), it.second.pip);
+        std::sort(wires.begin(), wires.end(),
+                  [](const std::pair<std::string, PipId> &a, const std::pair<std::string, PipId> &b) {
+                      return a.first < b.first;
+                  });
+        for (auto &w : wires) {
+            if (w.second == PipId())
+                f << "wire " << w.first << std::endl;
+            else
+                f << "pip " << ctx->getWireName(ctx->getPipSrcWire(w.second)).str(ctx) << " " << w.first
+                  << std::endl;
+        }
+        f << "end" << std::endl;
+    }
+    log_info("Wrote routing of %d nets to '%s'.\n", int(nets.size()), filename.c_str());
+}
+
+void restore_routing(Context *ctx, const std::string &filename)
+{
+    std::ifstream f(filename);
+    if (!f)
+        log_error("Failed to open routing file '%s' for reading\n", filename.c_str());
+
+    log_info("Restoring routing from '%s'..\n", filename.c_str());
+
+    std::vector<SavedNet> saved_nets;
+    SavedNet *curr = nullptr;
+    std::string line;
+    int lineno = 0;
+    while (std::getline(f, line)) {
+        lineno++;
+        std::istringstream ls(line);
+        std::string kw;
+        if (!(ls >> kw))
+            continue;
+        if (kw == "chip") {
+            std::string chip;
+            std::getline(ls >> std::ws, chip);
+            if (chip != ctx->getChipName()) {
+                log_warning("Routing file '%s' is for %s, not %s; not restoring any routing.\n", filename.c_str(),
+                            chip.c_str(), ctx->getChipName().c_str());
+                return;
+            }
+        } else if (kw == "net") {
+            saved_nets.emplace_back();
+            curr = &saved_nets.back();
+            ls >> curr->driver_bel >> curr->driver_port;
+            std::getline(ls >> std::ws, curr->name);
+            if (curr->name.empty())
+                log_error("%s:%d: missing net name\n", filename.c_str(), lineno);
+        } else if (curr == nullptr) {
+            log_error("%s:%d: '%s' outside of a net\n", filename.c_str(), lineno, kw.c_str());
+        } else if (kw == "sink") {
+            std::string bel, port;
+            ls >> bel >> port;
+            curr->sinks.emplace_back(bel, port);
+        } else if (kw == "wire") {
+            std::string wire;
+            ls >> wire;
+            curr->wires.push_back(wire);
+        } else if (kw == "pip") {
+            std::string src, dst;
+            ls >> src >> dst;
+            curr->pips.emplace_back(src, dst);
+        } else if (kw == "end") {
+            curr = nullptr;
+        } else {
+            log_error("%s:%d: unknown keyword '%s'\n", filename.c_str(), lineno, kw.c_str());
+        }
+    }
+
+    int full = 0, partial = 0, conflicting = 0, changed = 0;
+    for (auto &saved : saved_nets) {
+        auto it = ctx->nets.find(ctx->id(saved.name));
+        if (it == ctx->nets.end()) {
+            changed++;
+            continue;
+        }
+        NetInfo *net = it->second.get();
+
+        // Nets already routed (global clocks) keep their routing
+        if (!net->wires.empty())
+            continue;
+
+        // A moved driver invalidates the whole tree
+        if (endpoint_bel(ctx, net->driver) != saved.driver_bel || net->driver.port.str(ctx) != saved.driver_port) {
+            changed++;
+            continue;
+        }
+
+        if (!restore_net(ctx, net, saved)) {
+            if (ctx->verbose)
+                log_info("  routing of net %s conflicts, rerouting it\n", ctx->nameOf(net));
+            conflicting++;
+            continue;
+        }
+
+        bool all_sinks = true;
+        for (auto &user : net->users) {
+            auto sink = std::make_pair(endpoint_bel(ctx, user), user.port.str(ctx));
+            if (std::find(saved.sinks.begin(), saved.sinks.end(), sink) == saved.sinks.end())
+                all_sinks = false;
+        }
+        if (all_sinks && saved.sinks.size() == net->users.size())
+            full++;
+        else
+            partial++;
+    }
+
+    log_info("Restored routing of %d nets unchanged and %d nets with changed sinks; %d nets conflicted and %d nets "
+             "were changed or removed.\n",
+             full, partial, conflicting, changed);
+}
+
+NEXTPNR_NAMESPACE_END
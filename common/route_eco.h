@@ -0,0 +1,38 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef ROUTE_ECO_H
+#define ROUTE_ECO_H
+
+#include "nextpnr.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+// Write the routing of every net to a text file, keyed by net name and the bels of its driver and sinks, so that a
+// later run can reuse it with restore_routing
+void write_routing(Context *ctx, const std::string &filename);
+
+// Bind the routing saved by write_routing for nets whose name and driver are unchanged, at STRENGTH_STRONG. Nets
+// whose saved routing conflicts with wires or pips already in use are left unrouted. Branches to sinks that no
+// longer exist are left bound, the router removes them when it adopts the restored routing.
+void restore_routing(Context *ctx, const std::string &filename);
+
+NEXTPNR_NAMESPACE_END
+
+#endif // ROUTE_ECO_H
@@ -17,6 +17,7 @@
  *
  */
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <queue>
@@ -39,16 +40,6 @@ struct arc_key
     {
         return net_info == other.net_info ? user_idx < other.user_idx : net_info->name < other.net_info->name;
     }
-
-    struct Hash
-    {
-        std::size_t operator()(const arc_key &arg) const noexcept
-        {
-            std::size_t seed = std::hash<NetInfo *>()(arg.net_info);
-            seed ^= std::hash<int>()(arg.user_idx) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            return seed;
-        }
-    };
 };
 
 struct arc_entry
@@ -91,34 +82,304 @@ struct QueuedWire
     };
 };
 
+// Best route found so far to a wire during a single arc search. Entries are only valid if their epoch matches
+// the router's current search epoch, so that starting a new search doesn't need to touch the array
+struct VisitedWire
+{
+    PipId pip;
+    delay_t delay = 0, penalty = 0, bonus = 0;
+    uint32_t epoch = 0;
+};
+
+// Region an arc search may expand wires in
+struct ArcBounds
+{
+    int x0, y0, x1, y1;
+
+    bool contains(Loc loc) const { return loc.x >= x0 && loc.x <= x1 && loc.y >= y0 && loc.y <= y1; }
+};
+
+// Entry in the list of arcs using a wire. Entries live in a pool and are chained through next, -1 ends a list
+struct ArcOwner
+{
+    int32_t arc;
+    int32_t next;
+};
+
 struct Router1
 {
     Context *ctx;
     const Router1Cfg &cfg;
 
-    std::priority_queue<arc_entry, std::vector<arc_entry>, arc_entry::Less> arc_queue;
-    std::unordered_map<WireId, std::unordered_set<arc_key, arc_key::Hash>> wire_to_arcs;
-    std::unordered_map<arc_key, std::unordered_set<WireId>, arc_key::Hash> arc_to_wires;
-    std::unordered_set<arc_key, arc_key::Hash> queued_arcs;
-
-    std::unordered_map<WireId, QueuedWire> visited;
-    std::priority_queue<QueuedWire, std::vector<QueuedWire>, QueuedWire::Greater> queue;
+    // Nets are numbered through udata for the lifetime of the router, and arcs are numbered from arc_offset of
+    // their net in user order
+    std::vector<decltype(NetInfo::udata)> old_udata;
+    std::vector<NetInfo *> net_by_udata;
+    std::vector<int> arc_offset;
 
-    std::unordered_map<WireId, int> wireScores;
-    std::unordered_map<NetInfo *, int> netScores;
+    std::priority_queue<arc_entry, std::vector<arc_entry>, arc_entry::Less> arc_queue;
+    // Indexed by arc id
+    std::vector<std::vector<WireId>> arc_wires;
+    std::vector<uint8_t> arc_queued;
+    int queued_count = 0;
+    // Head of the list of arcs using each wire, indexed by ctx->getWireFlatIndex
+    std::vector<int32_t> wire_owners;
+    std::vector<ArcOwner> owner_pool;
+    int32_t free_owner = -1;
+    // Scratch space reused across rip-ups and arc routes
+    std::vector<WireId> scratch_wires;
+    std::vector<int> scratch_arcs;
+
+    // Indexed by ctx->getWireFlatIndex
+    std::vector<VisitedWire> visited;
+    std::vector<std::pair<WireId, delay_t>> seeds;
+    uint32_t visit_epoch = 0;
+    // Binary heap ordered by QueuedWire::Greater, kept across searches to reuse its storage
+    std::vector<QueuedWire> queue;
+
+    // Number of times each wire (by flat index) and net (by udata) has been ripped up
+    std::vector<int> wire_scores;
+    std::vector<int> net_scores;
 
     int arcs_with_ripup = 0;
     int arcs_without_ripup = 0;
     bool ripup_flag;
 
-    Router1(Context *ctx, const Router1Cfg &cfg) : ctx(ctx), cfg(cfg) {}
+    // Bounding box of the source and sink wires of each net by udata, x0 > x1 if not computed yet
+    std::vector<ArcBounds> net_bounds;
+    int64_t total_visits = 0;
+    int arc_searches = 0;
+    int bb_retries = 0;
+
+    // Timing weight (criticality ^ critExponent) of each arc by arc id, see refresh_criticalities
+    std::vector<float> arc_weight;
+    // Scale applied to the ripup penalties of the arc currently being searched
+    float penalty_scale = 1;
+    int routed_since_refresh = 0;
+    int crit_refreshes = 0;
+
+    Router1(Context *ctx, const Router1Cfg &cfg) : ctx(ctx), cfg(cfg)
+    {
+        visited.resize(ctx->getWireFlatIndexCount());
+        queue.reserve(1 << 16);
+
+        old_udata.reserve(ctx->nets.size());
+        arc_offset.push_back(0);
+        for (auto &net : ctx->nets) {
+            NetInfo *ni = net.second.get();
+            old_udata.push_back(ni->udata);
+            ni->udata = int(net_by_udata.size());
+            net_by_udata.push_back(ni);
+            arc_offset.push_back(arc_offset.back() + int(ni->users.size()));
+        }
+
+        arc_wires.resize(arc_offset.back());
+        arc_queued.resize(arc_offset.back());
+        arc_weight.resize(arc_offset.back());
+        wire_owners.resize(ctx->getWireFlatIndexCount(), -1);
+        wire_scores.resize(ctx->getWireFlatIndexCount());
+        net_scores.resize(net_by_udata.size());
+        ArcBounds no_bounds;
+        no_bounds.x0 = 0;
+        no_bounds.x1 = -1;
+        no_bounds.y0 = 0;
+        no_bounds.y1 = -1;
+        net_bounds.resize(net_by_udata.size(), no_bounds);
+    }
+
+    ~Router1()
+    {
+        for (auto ni : net_by_udata)
+            ni->udata = old_udata[ni->udata];
+    }
+
+    int arc_id(const arc_key &arc) const { return arc_offset[arc.net_info->udata] + arc.user_idx; }
+
+    arc_key arc_from_id(int id) const
+    {
+        // Nets without users share their offset with the next net, upper_bound skips past them
+        int net_idx = int(std::upper_bound(arc_offset.begin(), arc_offset.end(), id) - arc_offset.begin()) - 1;
+        arc_key arc;
+        arc.net_info = net_by_udata[net_idx];
+        arc.user_idx = id - arc_offset[net_idx];
+        return arc;
+    }
+
+    void add_owner(WireId wire, int arc)
+    {
+        int32_t entry;
+        if (free_owner != -1) {
+            entry = free_owner;
+            free_owner = owner_pool[entry].next;
+        } else {
+            entry = int32_t(owner_pool.size());
+            owner_pool.emplace_back();
+        }
+        int32_t &head = wire_owners[ctx->getWireFlatIndex(wire)];
+        owner_pool[entry].arc = arc;
+        owner_pool[entry].next = head;
+        head = entry;
+    }
+
+    // Returns true if the wire has no owners left
+    bool remove_owner(WireId wire, int arc)
+    {
+        int32_t *link = &wire_owners[ctx->getWireFlatIndex(wire)];
+        while (*link != -1) {
+            int32_t entry = *link;
+            if (owner_pool[entry].arc == arc) {
+                *link = owner_pool[entry].next;
+                owner_pool[entry].next = free_owner;
+                free_owner = entry;
+                break;
+            }
+            link = &owner_pool[entry].next;
+        }
+        return wire_owners[ctx->getWireFlatIndex(wire)] == -1;
+    }
+
+    // Callers never add a wire twice: route_arc drops all wires of an arc before binding its new route, and a single
+    // backtrace doesn't revisit a wire. Checking that would walk the owner list, which is long on high fanout nets
+    void add_arc_wire(int arc, WireId wire)
+    {
+#ifndef NDEBUG
+        NPNR_ASSERT(!has_owner(wire, arc));
+#endif
+        arc_wires[arc].push_back(wire);
+        add_owner(wire, arc);
+    }
+
+    bool has_owner(WireId wire, int arc) const
+    {
+        for (int32_t entry = wire_owners[ctx->getWireFlatIndex(wire)]; entry != -1; entry = owner_pool[entry].next)
+            if (owner_pool[entry].arc == arc)
+                return true;
+        return false;
+    }
+
+    // Remove the wire from all arcs using it and append those arcs to arcs
+    void clear_owners(WireId wire, std::vector<int> &arcs)
+    {
+        int32_t &head = wire_owners[ctx->getWireFlatIndex(wire)];
+        while (head != -1) {
+            int32_t entry = head;
+            int arc = owner_pool[entry].arc;
+            auto &wires = arc_wires[arc];
+            auto fnd = std::find(wires.begin(), wires.end(), wire);
+            NPNR_ASSERT(fnd != wires.end());
+            *fnd = wires.back();
+            wires.pop_back();
+            arcs.push_back(arc);
+            head = owner_pool[entry].next;
+            owner_pool[entry].next = free_owner;
+            free_owner = entry;
+        }
+    }
+
+    void start_search()
+    {
+        queue.clear();
+        if (++visit_epoch == 0) {
+            for (auto &v : visited)
+                v.epoch = 0;
+            visit_epoch = 1;
+        }
+    }
+
+    ArcBounds get_arc_bounds(NetInfo *net_info, int margin)
+    {
+        ArcBounds bb;
+        if (margin < 0) {
+            bb.x0 = 0;
+            bb.y0 = 0;
+            bb.x1 = ctx->getGridDimX() - 1;
+            bb.y1 = ctx->getGridDimY() - 1;
+            return bb;
+        }
+        if (net_bounds[net_info->udata].x0 <= net_bounds[net_info->udata].x1) {
+            bb = net_bounds[net_info->udata];
+        } else {
+            Loc src_loc = ctx->getWireLocation(ctx->getNetinfoSourceWire(net_info));
+            bb.x0 = bb.x1 = src_loc.x;
+            bb.y0 = bb.y1 = src_loc.y;
+            for (auto &user : net_info->users) {
+                Loc dst_loc = ctx->getWireLocation(ctx->getNetinfoSinkWire(net_info, user));
+                bb.x0 = std::min(bb.x0, dst_loc.x);
+                bb.y0 = std::min(bb.y0, dst_loc.y);
+                bb.x1 = std::max(bb.x1, dst_loc.x);
+                bb.y1 = std::max(bb.y1, dst_loc.y);
+            }
+            net_bounds[net_info->udata] = bb;
+        }
+        bb.x0 -= margin;
+        bb.y0 -= margin;
+        bb.x1 += margin;
+        bb.y1 += margin;
+        return bb;
+    }
+
+    bool bb_covers_device(const ArcBounds &bb)
+    {
+        return bb.x0 <= 0 && bb.y0 <= 0 && bb.x1 >= ctx->getGridDimX() - 1 && bb.y1 >= ctx->getGridDimY() - 1;
+    }
+
+    ArcBounds widen_arc_bounds(const ArcBounds &bb)
+    {
+        int grow = std::max(cfg.bbMargin, 1) + std::max(bb.x1 - bb.x0, bb.y1 - bb.y0) / 2;
+        ArcBounds wide = bb;
+        wide.x0 -= grow;
+        wide.y0 -= grow;
+        wide.x1 += grow;
+        wide.y1 += grow;
+        return wide;
+    }
+
+    VisitedWire *get_visited(WireId wire)
+    {
+        auto &v = visited[ctx->getWireFlatIndex(wire)];
+        return v.epoch == visit_epoch ? &v : nullptr;
+    }
+
+    void visit(const QueuedWire &qw)
+    {
+        auto &v = visited[ctx->getWireFlatIndex(qw.wire)];
+        v.pip = qw.pip;
+        v.delay = qw.delay;
+        v.penalty = qw.penalty;
+        v.bonus = qw.bonus;
+        v.epoch = visit_epoch;
+        queue.push_back(qw);
+        std::push_heap(queue.begin(), queue.end(), QueuedWire::Greater());
+    }
+
+    // Recompute arc criticalities from the current routing, using the routed delay of arcs that are routed and the
+    // predicted delay of the others
+    void refresh_criticalities()
+    {
+        NetCriticalityMap net_crit;
+        get_criticalities(ctx, &net_crit);
+        std::fill(arc_weight.begin(), arc_weight.end(), 0);
+        for (auto ni : net_by_udata) {
+            auto fnd = net_crit.find(ni->name);
+            if (fnd == net_crit.end())
+                continue;
+            const auto &nc = fnd->second;
+            int offset = arc_offset[ni->udata];
+            for (size_t i = 0; i < nc.criticality.size() && i < ni->users.size(); i++)
+                arc_weight[offset + i] = std::pow(nc.criticality.at(i), cfg.critExponent);
+        }
+        routed_since_refresh = 0;
+        crit_refreshes++;
+    }
 
     void arc_queue_insert(const arc_key &arc, WireId src_wire, WireId dst_wire)
     {
-        if (queued_arcs.count(arc))
+        if (arc_queued[arc_id(arc)])
             return;
 
-        delay_t pri = ctx->estimateDelay(src_wire, dst_wire) - arc.net_info->users[arc.user_idx].budget;
+        // Critical arcs are routed first, using the criticality from the last refresh
+        delay_t pri = ctx->estimateDelay(src_wire, dst_wire) - arc.net_info->users[arc.user_idx].budget +
+                      delay_t(arc_weight[arc_id(arc)] * cfg.critPriority);
 
         arc_entry entry;
         entry.arc = arc;
@@ -132,12 +393,13 @@ struct Router1
 #endif
 
         arc_queue.push(entry);
-        queued_arcs.insert(arc);
+        arc_queued[arc_id(arc)] = 1;
+        queued_count++;
     }
 
     void arc_queue_insert(const arc_key &arc)
     {
-        if (queued_arcs.count(arc))
+        if (arc_queued[arc_id(arc)])
             return;
 
         NetInfo *net_info = arc.net_info;
@@ -149,8 +411,17 @@ struct Router1
         arc_queue_insert(arc, src_wire, dst_wire);
     }
 
+    // Entries whose arc has already been dequeued by pop_net_arcs are stale and dropped here
+    bool arc_queue_empty()
+    {
+        while (!arc_queue.empty() && !arc_queued[arc_id(arc_queue.top().arc)])
+            arc_queue.pop();
+        return arc_queue.empty();
+    }
+
     arc_key arc_queue_pop()
     {
+        NPNR_ASSERT(!arc_queue_empty());
         arc_entry entry = arc_queue.top();
 
 #if 0
@@ -160,42 +431,101 @@ struct Router1
 #endif
 
         arc_queue.pop();
-        queued_arcs.erase(entry.arc);
+        arc_queued[arc_id(entry.arc)] = 0;
+        queued_count--;
         return entry.arc;
     }
 
-    void ripup_net(NetInfo *net)
+    // Take all other queued arcs of the same net out of the queue, and order them nearest sink first
+    std::vector<arc_key> pop_net_arcs(const arc_key &arc)
     {
-        if (ctx->debug)
-            log("      ripup net %s\n", ctx->nameOf(net));
+        NetInfo *net_info = arc.net_info;
+        auto src_wire = ctx->getNetinfoSourceWire(net_info);
 
-        netScores[net]++;
+        std::vector<std::pair<delay_t, arc_key>> net_arcs;
+        net_arcs.emplace_back(0, arc);
+        for (int user_idx = 0; user_idx < int(net_info->users.size()); user_idx++) {
+            arc_key other;
+            other.net_info = net_info;
+            other.user_idx = user_idx;
+            if (!arc_queued[arc_id(other)])
+                continue;
+            arc_queued[arc_id(other)] = 0;
+            queued_count--;
+            net_arcs.emplace_back(0, other);
+        }
+        for (auto &it : net_arcs)
+            it.first = ctx->estimateDelay(src_wire,
+                                          ctx->getNetinfoSinkWire(net_info, net_info->users[it.second.user_idx]));
+        std::stable_sort(net_arcs.begin(), net_arcs.end(),
+                         [](const std::pair<delay_t, arc_key> &a, const std::pair<delay_t, arc_key> &b) {
+                             return a.first < b.first;
+                         });
+
+        std::vector<arc_key> arcs;
+        for (auto &it : net_arcs)
+            arcs.push_back(it.second);
+        return arcs;
+    }
 
-        std::vector<WireId> wires;
-        for (auto &it : net->wires)
-            wires.push_back(it.first);
+    // Wires of the net's current route that are connected to src_wire, with their delay from it
+    void get_tree_seeds(NetInfo *net_info, WireId src_wire, std::vector<std::pair<WireId, delay_t>> &seeds)
+    {
+        seeds.clear();
+        seeds.emplace_back(src_wire, ctx->getWireDelay(src_wire).maxDelay());
+        if (!net_info->wires.count(src_wire))
+            return;
 
-        ctx->sorted_shuffle(wires);
+        std::unordered_map<WireId, std::vector<PipId>> children;
+        for (auto &it : net_info->wires)
+            if (it.second.pip != PipId())
+                children[ctx->getPipSrcWire(it.second.pip)].push_back(it.second.pip);
 
-        for (WireId w : wires) {
-            std::vector<arc_key> arcs;
-            for (auto &it : wire_to_arcs[w]) {
-                arc_to_wires[it].erase(w);
-                arcs.push_back(it);
+        for (size_t i = 0; i < seeds.size(); i++) {
+            auto fnd = children.find(seeds[i].first);
+            if (fnd == children.end())
+                continue;
+            for (PipId pip : fnd->second) {
+                WireId dst = ctx->getPipDstWire(pip);
+                seeds.emplace_back(dst, seeds[i].second + ctx->getPipDelay(pip).maxDelay() +
+                                                ctx->getWireDelay(dst).maxDelay());
             }
-            wire_to_arcs[w].clear();
+        }
+    }
 
-            ctx->sorted_shuffle(arcs);
+    // Remove a wire from all arcs using it, queue those arcs for rerouting and unbind the wire
+    void ripup_wire_arcs(WireId w, const char *indent)
+    {
+        scratch_arcs.clear();
+        clear_owners(w, scratch_arcs);
 
-            for (auto &it : arcs)
-                arc_queue_insert(it);
+        ctx->sorted_shuffle(scratch_arcs);
 
-            if (ctx->debug)
-                log("        unbind wire %s\n", ctx->nameOfWire(w));
+        for (int arc : scratch_arcs)
+            arc_queue_insert(arc_from_id(arc));
 
-            ctx->unbindWire(w);
-            wireScores[w]++;
-        }
+        if (ctx->debug)
+            log("%sunbind wire %s\n", indent, ctx->nameOfWire(w));
+
+        ctx->unbindWire(w);
+        wire_scores[ctx->getWireFlatIndex(w)]++;
+    }
+
+    void ripup_net(NetInfo *net)
+    {
+        if (ctx->debug)
+            log("      ripup net %s\n", ctx->nameOf(net));
+
+        net_scores[net->udata]++;
+
+        scratch_wires.clear();
+        for (auto &it : net->wires)
+            scratch_wires.push_back(it.first);
+
+        ctx->sorted_shuffle(scratch_wires);
+
+        for (WireId w : scratch_wires)
+            ripup_wire_arcs(w, "        ");
 
         ripup_flag = true;
     }
@@ -212,23 +542,7 @@ struct Router1
             if (n != nullptr)
                 ripup_net(n);
         } else {
-            std::vector<arc_key> arcs;
-            for (auto &it : wire_to_arcs[w]) {
-                arc_to_wires[it].erase(w);
-                arcs.push_back(it);
-            }
-            wire_to_arcs[w].clear();
-
-            ctx->sorted_shuffle(arcs);
-
-            for (auto &it : arcs)
-                arc_queue_insert(it);
-
-            if (ctx->debug)
-                log("      unbind wire %s\n", ctx->nameOfWire(w));
-
-            ctx->unbindWire(w);
-            wireScores[w]++;
+            ripup_wire_arcs(w, "      ");
         }
 
         ripup_flag = true;
@@ -246,23 +560,7 @@ struct Router1
             if (n != nullptr)
                 ripup_net(n);
         } else {
-            std::vector<arc_key> arcs;
-            for (auto &it : wire_to_arcs[w]) {
-                arc_to_wires[it].erase(w);
-                arcs.push_back(it);
-            }
-            wire_to_arcs[w].clear();
-
-            ctx->sorted_shuffle(arcs);
-
-            for (auto &it : arcs)
-                arc_queue_insert(it);
-
-            if (ctx->debug)
-                log("      unbind wire %s\n", ctx->nameOfWire(w));
-
-            ctx->unbindWire(w);
-            wireScores[w]++;
+            ripup_wire_arcs(w, "      ");
         }
 
         ripup_flag = true;
@@ -284,20 +582,12 @@ struct Router1
 
     void check()
     {
-        std::unordered_set<arc_key, arc_key::Hash> valid_arcs;
-
-        for (auto &net_it : ctx->nets) {
-            NetInfo *net_info = net_it.second.get();
-            std::unordered_set<WireId> valid_wires_for_net;
+        std::vector<int> wire_arc_count(wire_owners.size());
 
+        for (auto net_info : net_by_udata) {
             if (skip_net(net_info))
                 continue;
 
-#if 0
-            if (ctx->debug)
-                log("[check] net: %s\n", ctx->nameOf(net_info));
-#endif
-
             auto src_wire = ctx->getNetinfoSourceWire(net_info);
             log_assert(src_wire != WireId());
 
@@ -308,37 +598,25 @@ struct Router1
                 arc_key arc;
                 arc.net_info = net_info;
                 arc.user_idx = user_idx;
+                int id = arc_id(arc);
 
-                valid_arcs.insert(arc);
-#if 0
-                if (ctx->debug)
-                    log("[check]   arc: %s %s\n", ctx->nameOfWire(src_wire), ctx->nameOfWire(dst_wire));
-#endif
-
-                for (WireId wire : arc_to_wires[arc]) {
-#if 0
-                    if (ctx->debug)
-                        log("[check]     wire: %s\n", ctx->nameOfWire(wire));
-#endif
-                    valid_wires_for_net.insert(wire);
-                    log_assert(wire_to_arcs[wire].count(arc));
+                for (WireId wire : arc_wires[id]) {
+                    log_assert(has_owner(wire, id));
                     log_assert(net_info->wires.count(wire));
+                    wire_arc_count[ctx->getWireFlatIndex(wire)]++;
                 }
             }
 
-            for (auto &it : net_info->wires) {
-                WireId w = it.first;
-                log_assert(valid_wires_for_net.count(w));
-            }
-        }
-
-        for (auto &it : wire_to_arcs) {
-            for (auto &arc : it.second)
-                log_assert(valid_arcs.count(arc));
+            for (auto &it : net_info->wires)
+                log_assert(wire_owners[ctx->getWireFlatIndex(it.first)] != -1);
         }
 
-        for (auto &it : arc_to_wires) {
-            log_assert(valid_arcs.count(it.first));
+        // Every owner entry must be matched by the wire appearing in that arc
+        for (int i = 0; i < int(wire_owners.size()); i++) {
+            int count = 0;
+            for (int32_t entry = wire_owners[i]; entry != -1; entry = owner_pool[entry].next)
+                count++;
+            log_assert(count == wire_arc_count[i]);
         }
     }
 
@@ -405,22 +683,27 @@ struct Router1
                     continue;
                 }
 
+                // Only an arc whose route reaches the source owns its wires. Partial routes (such as restored ECO
+                // routing for a moved sink) are queued without owning anything, so their stale wires get unbound below
                 WireId cursor = dst_wire;
-                wire_to_arcs[cursor].insert(arc);
-                arc_to_wires[arc].insert(cursor);
+                scratch_wires.clear();
+                scratch_wires.push_back(cursor);
 
                 while (src_wire != cursor) {
                     auto it = net_info->wires.find(cursor);
-                    if (it == net_info->wires.end()) {
-                        arc_queue_insert(arc, src_wire, dst_wire);
+                    if (it == net_info->wires.end() || it->second.pip == PipId())
                         break;
-                    }
-
-                    NPNR_ASSERT(it->second.pip != PipId());
                     cursor = ctx->getPipSrcWire(it->second.pip);
-                    wire_to_arcs[cursor].insert(arc);
-                    arc_to_wires[arc].insert(cursor);
+                    scratch_wires.push_back(cursor);
                 }
+
+                if (cursor != src_wire) {
+                    arc_queue_insert(arc, src_wire, dst_wire);
+                    continue;
+                }
+
+                for (WireId w : scratch_wires)
+                    add_arc_wire(arc_id(arc), w);
             }
 
             src_to_net[src_wire] = net_info;
@@ -428,7 +711,7 @@ struct Router1
             std::vector<WireId> unbind_wires;
 
             for (auto &it : net_info->wires)
-                if (it.second.strength < STRENGTH_LOCKED && wire_to_arcs.count(it.first) == 0)
+                if (it.second.strength < STRENGTH_LOCKED && wire_owners[ctx->getWireFlatIndex(it.first)] == -1)
                     unbind_wires.push_back(it.first);
 
             for (auto it : unbind_wires)
@@ -436,46 +719,12 @@ struct Router1
         }
     }
 
-    bool route_arc(const arc_key &arc, bool ripup)
+    // A* search from src_wire to dst_wire, only expanding wires located inside bb. Results are left in visited
+    void search_arc(NetInfo *net_info, WireId src_wire, WireId dst_wire, bool ripup, const ArcBounds &bb)
     {
-
-        NetInfo *net_info = arc.net_info;
-        int user_idx = arc.user_idx;
-
-        auto src_wire = ctx->getNetinfoSourceWire(net_info);
-        auto dst_wire = ctx->getNetinfoSinkWire(net_info, net_info->users[user_idx]);
-        ripup_flag = false;
-
-        if (ctx->debug) {
-            log("Routing arc %d on net %s (%d arcs total):\n", user_idx, ctx->nameOf(net_info),
-                int(net_info->users.size()));
-            log("  source ... %s\n", ctx->nameOfWire(src_wire));
-            log("  sink ..... %s\n", ctx->nameOfWire(dst_wire));
-        }
-
-        // unbind wires that are currently used exclusively by this arc
-
-        std::unordered_set<WireId> old_arc_wires;
-        old_arc_wires.swap(arc_to_wires[arc]);
-
-        for (WireId wire : old_arc_wires) {
-            auto &arc_wires = wire_to_arcs.at(wire);
-            NPNR_ASSERT(arc_wires.count(arc));
-            arc_wires.erase(arc);
-            if (arc_wires.empty()) {
-                if (ctx->debug)
-                    log("  unbind %s\n", ctx->nameOfWire(wire));
-                ctx->unbindWire(wire);
-            }
-        }
-
         // reset wire queue
 
-        if (!queue.empty()) {
-            std::priority_queue<QueuedWire, std::vector<QueuedWire>, QueuedWire::Greater> new_queue;
-            queue.swap(new_queue);
-        }
-        visited.clear();
+        start_search();
 
         // A* main loop
 
@@ -484,26 +733,38 @@ struct Router1
         delay_t best_est = 0;
         delay_t best_score = -1;
 
-        {
+        // In net routing mode the search starts from every wire already routed for the net, otherwise just from
+        // the source. Seeds keep a null pip; route_arc follows the existing route from them back to the source
+        if (cfg.netRouting)
+            get_tree_seeds(net_info, src_wire, seeds);
+        else
+            seeds.assign(1, std::make_pair(src_wire, ctx->getWireDelay(src_wire).maxDelay()));
+
+        for (auto &seed : seeds) {
             QueuedWire qw;
-            qw.wire = src_wire;
+            qw.wire = seed.first;
             qw.pip = PipId();
-            qw.delay = ctx->getWireDelay(qw.wire).maxDelay();
+            qw.delay = seed.second;
             qw.penalty = 0;
             qw.bonus = 0;
             if (cfg.useEstimate) {
                 qw.togo = ctx->estimateDelay(qw.wire, dst_wire);
-                best_est = qw.delay + qw.togo;
+                if (qw.wire == src_wire || qw.delay + qw.togo < best_est)
+                    best_est = qw.delay + qw.togo;
             }
             qw.randtag = ctx->rng();
 
-            queue.push(qw);
-            visited[qw.wire] = qw;
+            visit(qw);
         }
 
+        // The sink may already be part of the route if another user shares its wire
+        if (get_visited(dst_wire) != nullptr)
+            maxVisitCnt = 0;
+
         while (visitCnt++ < maxVisitCnt && !queue.empty()) {
-            QueuedWire qw = queue.top();
-            queue.pop();
+            std::pop_heap(queue.begin(), queue.end(), QueuedWire::Greater());
+            QueuedWire qw = queue.back();
+            queue.pop_back();
 
             for (auto pip : ctx->getPipsDownhill(qw.wire)) {
                 delay_t next_delay = qw.delay + ctx->getPipDelay(pip).maxDelay();
@@ -511,6 +772,11 @@ struct Router1
                 delay_t next_bonus = qw.bonus;
 
                 WireId next_wire = ctx->getPipDstWire(pip);
+                if (!bb.contains(ctx->getWireLocation(next_wire)))
+                    continue;
+                // Wires of the net's own route were all seeded
+                if (cfg.netRouting && net_info->wires.count(next_wire))
+                    continue;
                 next_delay += ctx->getWireDelay(next_wire).maxDelay();
 
                 WireId conflictWireWire = WireId(), conflictPipWire = WireId();
@@ -555,35 +821,31 @@ struct Router1
                     if (conflictWireNet == conflictPipNet)
                         conflictWireNet = nullptr;
 
+                    delay_t conflict_penalty = 0;
+
                     if (conflictWireWire != WireId()) {
-                        auto scores_it = wireScores.find(conflictWireWire);
-                        if (scores_it != wireScores.end())
-                            next_penalty += scores_it->second * cfg.wireRipupPenalty;
-                        next_penalty += cfg.wireRipupPenalty;
+                        conflict_penalty += wire_scores[ctx->getWireFlatIndex(conflictWireWire)] * cfg.wireRipupPenalty;
+                        conflict_penalty += cfg.wireRipupPenalty;
                     }
 
                     if (conflictPipWire != WireId()) {
-                        auto scores_it = wireScores.find(conflictPipWire);
-                        if (scores_it != wireScores.end())
-                            next_penalty += scores_it->second * cfg.wireRipupPenalty;
-                        next_penalty += cfg.wireRipupPenalty;
+                        conflict_penalty += wire_scores[ctx->getWireFlatIndex(conflictPipWire)] * cfg.wireRipupPenalty;
+                        conflict_penalty += cfg.wireRipupPenalty;
                     }
 
                     if (conflictWireNet != nullptr) {
-                        auto scores_it = netScores.find(conflictWireNet);
-                        if (scores_it != netScores.end())
-                            next_penalty += scores_it->second * cfg.netRipupPenalty;
-                        next_penalty += cfg.netRipupPenalty;
-                        next_penalty += conflictWireNet->wires.size() * cfg.wireRipupPenalty;
+                        conflict_penalty += net_scores[conflictWireNet->udata] * cfg.netRipupPenalty;
+                        conflict_penalty += cfg.netRipupPenalty;
+                        conflict_penalty += conflictWireNet->wires.size() * cfg.wireRipupPenalty;
                     }
 
                     if (conflictPipNet != nullptr) {
-                        auto scores_it = netScores.find(conflictPipNet);
-                        if (scores_it != netScores.end())
-                            next_penalty += scores_it->second * cfg.netRipupPenalty;
-                        next_penalty += cfg.netRipupPenalty;
-                        next_penalty += conflictPipNet->wires.size() * cfg.wireRipupPenalty;
+                        conflict_penalty += net_scores[conflictPipNet->udata] * cfg.netRipupPenalty;
+                        conflict_penalty += cfg.netRipupPenalty;
+                        conflict_penalty += conflictPipNet->wires.size() * cfg.wireRipupPenalty;
                     }
+
+                    next_penalty += conflict_penalty * penalty_scale;
                 }
 
                 delay_t next_score = next_delay + next_penalty;
@@ -592,10 +854,10 @@ struct Router1
                 if ((best_score >= 0) && (next_score - next_bonus - cfg.estimatePrecision > best_score))
                     continue;
 
-                auto old_visited_it = visited.find(next_wire);
-                if (old_visited_it != visited.end()) {
-                    delay_t old_delay = old_visited_it->second.delay;
-                    delay_t old_score = old_delay + old_visited_it->second.penalty;
+                auto old_visited = get_visited(next_wire);
+                if (old_visited != nullptr) {
+                    delay_t old_delay = old_visited->delay;
+                    delay_t old_score = old_delay + old_visited->penalty;
                     NPNR_ASSERT(old_score >= 0);
 
                     if (next_score + ctx->getDelayEpsilon() >= old_score)
@@ -606,7 +868,7 @@ struct Router1
                         log("Found better route to %s. Old vs new delay estimate: %.3f (%.3f) %.3f (%.3f)\n",
                             ctx->nameOfWire(next_wire),
                             ctx->getDelayNS(old_score),
-                            ctx->getDelayNS(old_visited_it->second.delay),
+                            ctx->getDelayNS(old_visited->delay),
                             ctx->getDelayNS(next_score),
                             ctx->getDelayNS(next_delay));
 #endif
@@ -637,8 +899,7 @@ struct Router1
                         ctx->getDelayNS(next_delay));
 #endif
 
-                visited[next_qw.wire] = next_qw;
-                queue.push(next_qw);
+                visit(next_qw);
 
                 if (next_wire == dst_wire) {
                     maxVisitCnt = std::min(maxVisitCnt, 2 * visitCnt + (next_qw.penalty > 0 ? 100 : 0));
@@ -649,29 +910,79 @@ struct Router1
 
         if (ctx->debug)
             log("  total number of visited nodes: %d\n", visitCnt);
+        total_visits += visitCnt;
+    }
+    bool route_arc(const arc_key &arc, bool ripup)
+    {
+
+        NetInfo *net_info = arc.net_info;
+        int user_idx = arc.user_idx;
+
+        auto src_wire = ctx->getNetinfoSourceWire(net_info);
+        auto dst_wire = ctx->getNetinfoSinkWire(net_info, net_info->users[user_idx]);
+        ripup_flag = false;
 
-        if (visited.count(dst_wire) == 0) {
+        if (ctx->debug) {
+            log("Routing arc %d on net %s (%d arcs total):\n", user_idx, ctx->nameOf(net_info),
+                int(net_info->users.size()));
+            log("  source ... %s\n", ctx->nameOfWire(src_wire));
+            log("  sink ..... %s\n", ctx->nameOfWire(dst_wire));
+        }
+
+        // unbind wires that are currently used exclusively by this arc
+
+        int id = arc_id(arc);
+        // Swapping with the (empty) scratch vector keeps both buffers allocated for reuse
+        scratch_wires.clear();
+        scratch_wires.swap(arc_wires[id]);
+
+        for (WireId wire : scratch_wires) {
+            if (remove_owner(wire, id)) {
+                if (ctx->debug)
+                    log("  unbind %s\n", ctx->nameOfWire(wire));
+                ctx->unbindWire(wire);
+            }
+        }
+
+        penalty_scale = 1;
+        if (ctx->timing_driven)
+            penalty_scale = 1 - std::min(arc_weight[id], cfg.maxCriticality);
+
+        ArcBounds bb = get_arc_bounds(net_info, cfg.bbMargin);
+        while (1) {
+            search_arc(net_info, src_wire, dst_wire, ripup, bb);
+            arc_searches++;
+            if (get_visited(dst_wire) != nullptr || bb_covers_device(bb))
+                break;
+            // No route inside the box, retry with a wider one
+            bb_retries++;
+            bb = widen_arc_bounds(bb);
+        }
+
+        auto dst_visited = get_visited(dst_wire);
+        if (dst_visited == nullptr) {
             if (ctx->debug)
                 log("  no route found for this arc\n");
             return false;
         }
 
         if (ctx->debug) {
-            log("  final route delay:   %8.2f\n", ctx->getDelayNS(visited[dst_wire].delay));
-            log("  final route penalty: %8.2f\n", ctx->getDelayNS(visited[dst_wire].penalty));
-            log("  final route bonus:   %8.2f\n", ctx->getDelayNS(visited[dst_wire].bonus));
+            log("  final route delay:   %8.2f\n", ctx->getDelayNS(dst_visited->delay));
+            log("  final route penalty: %8.2f\n", ctx->getDelayNS(dst_visited->penalty));
+            log("  final route bonus:   %8.2f\n", ctx->getDelayNS(dst_visited->bonus));
             log("  arc budget:      %12.2f\n", ctx->getDelayNS(net_info->users[user_idx].budget));
         }
 
         // bind resulting route (and maybe unroute other nets)
 
-        std::unordered_set<WireId> unassign_wires = arc_to_wires[arc];
-
         WireId cursor = dst_wire;
         delay_t accumulated_path_delay = 0;
         delay_t last_path_delay_delta = 0;
         while (1) {
-            auto pip = visited[cursor].pip;
+            auto pip = get_visited(cursor)->pip;
+            // A seed from the existing route of the net, follow that route back to the source
+            if (pip == PipId() && cursor != src_wire)
+                pip = net_info->wires.at(cursor).pip;
 
             if (ctx->debug) {
                 delay_t path_delay_delta = ctx->estimateDelay(cursor, dst_wire) - accumulated_path_delay;
@@ -711,8 +1022,7 @@ struct Router1
                 }
             }
 
-            wire_to_arcs[cursor].insert(arc);
-            arc_to_wires[arc].insert(cursor);
+            add_arc_wire(id, cursor);
 
             if (pip == PipId())
                 break;
@@ -724,6 +1034,7 @@ struct Router1
             arcs_with_ripup++;
         else
             arcs_without_ripup++;
+        routed_since_refresh++;
 
         return true;
     }
@@ -743,8 +1054,15 @@ Router1Cfg::Router1Cfg(Context *ctx) : Settings(ctx)
     wireRipupPenalty = ctx->getRipupDelayPenalty();
     netRipupPenalty = 10 * ctx->getRipupDelayPenalty();
     reuseBonus = wireRipupPenalty / 2;
+    critPriority = 10 * ctx->getRipupDelayPenalty();
 
     estimatePrecision = 100 * ctx->getRipupDelayPenalty();
+
+    bbMargin = get<int>("router1/bbMargin", 3);
+    netRouting = get<bool>("router1/netRouting", false);
+    critRefreshArcs = get<int>("router1/critRefreshArcs", 5000);
+    critExponent = get<float>("router1/critExponent", 3);
+    maxCriticality = get<float>("router1/maxCriticality", 0.95);
 }
 
 bool router1(Context *ctx, const Router1Cfg &cfg)
@@ -758,6 +1076,9 @@ bool router1(Context *ctx, const Router1Cfg &cfg)
         log_info("Setting up routing queue.\n");
 
         Router1 router(ctx, cfg);
+        // Before setup, so that the initial arc queue is already ordered by criticality
+        if (ctx->timing_driven)
+            router.refresh_criticalities();
         router.setup();
 #ifndef NDEBUG
         router.check();
@@ -772,11 +1093,11 @@ bool router1(Context *ctx, const Router1Cfg &cfg)
         log_info("           |   (re-)routed arcs  |   delta    | remaining\n");
         log_info("   IterCnt |  w/ripup   wo/ripup |  w/r  wo/r |      arcs\n");
 
-        while (!router.arc_queue.empty()) {
+        while (!router.arc_queue_empty()) {
             if (++iter_cnt % 1000 == 0) {
                 log_info("%10d | %8d %10d | %4d %5d | %9d\n", iter_cnt, router.arcs_with_ripup,
                          router.arcs_without_ripup, router.arcs_with_ripup - last_arcs_with_ripup,
-                         router.arcs_without_ripup - last_arcs_without_ripup, int(router.arc_queue.size()));
+                         router.arcs_without_ripup - last_arcs_without_ripup, router.queued_count);
                 last_arcs_with_ripup = router.arcs_with_ripup;
                 last_arcs_without_ripup = router.arcs_without_ripup;
                 ctx->yield();
@@ -785,26 +1106,44 @@ bool router1(Context *ctx, const Router1Cfg &cfg)
 #endif
             }
 
+            if (ctx->timing_driven && router.routed_since_refresh >= cfg.critRefreshArcs)
+                router.refresh_criticalities();
+
             if (ctx->debug)
                 log("-- %d --\n", iter_cnt);
 
             arc_key arc = router.arc_queue_pop();
-
-            if (!router.route_arc(arc, true)) {
-                log_warning("Failed to find a route for arc %d of net %s.\n", arc.user_idx, ctx->nameOf(arc.net_info));
+            std::vector<arc_key> arcs;
+            if (cfg.netRouting)
+                arcs = router.pop_net_arcs(arc);
+            else
+                arcs.push_back(arc);
+
+            for (auto &it : arcs) {
+                if (!router.route_arc(it, true)) {
+                    log_warning("Failed to find a route for arc %d of net %s.\n", it.user_idx,
+                                ctx->nameOf(it.net_info));
 #ifndef NDEBUG
-                router.check();
-                ctx->check();
+                    router.check();
+                    ctx->check();
 #endif
-                ctx->unlock();
-                return false;
+                    ctx->unlock();
+                    return false;
+                }
             }
         }
 
         log_info("%10d | %8d %10d | %4d %5d | %9d\n", iter_cnt, router.arcs_with_ripup, router.arcs_without_ripup,
                  router.arcs_with_ripup - last_arcs_with_ripup, router.arcs_without_ripup - last_arcs_without_ripup,
-                 int(router.arc_queue.size()));
+                 router.queued_count);
         log_info("Routing complete.\n");
+        if (router.arc_searches > 0)
+            log_info("Expanded %lld wires in %d arc searches (%.1f per search), %d searches retried with a larger "
+                     "bounding box.\n",
+                     (long long)router.total_visits, router.arc_searches,
+                     double(router.total_visits) / router.arc_searches, router.bb_retries);
+        if (ctx->timing_driven)
+            log_info("Updated arc criticalities %d times.\n", router.crit_refreshes);
         auto rend = std::chrono::high_resolution_clock::now();
         ctx->yield();
         log_info("Route time %.02fs\n", std::chrono::duration<float>(rend - rstart).count());
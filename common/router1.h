@@ -37,6 +37,20 @@ struct Router1Cfg : Settings
     delay_t netRipupPenalty;
     delay_t reuseBonus;
     delay_t estimatePrecision;
+    // Arc searches only expand wires inside the net's bounding box grown by this many tiles, widening the box if
+    // no route is found. Negative to search the whole device
+    int bbMargin;
+    // Route all queued arcs of a net together, nearest sink first, with each search starting from the route
+    // found so far for the net instead of only its source
+    bool netRouting;
+    // Rerun timing analysis after this many routed arcs when timing-driven routing is enabled
+    int critRefreshArcs;
+    // Ripup penalties of an arc are scaled by 1 - min(criticality ^ critExponent, maxCriticality), so that critical
+    // arcs favour a fast route over avoiding congestion
+    float critExponent;
+    float maxCriticality;
+    // Added to the queue priority of an arc, scaled by its criticality ^ critExponent
+    delay_t critPriority;
 };
 
 extern bool router1(Context *ctx, const Router1Cfg &cfg);
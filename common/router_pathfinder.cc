@@ -0,0 +1,602 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * PathFinder-style negotiated congestion router
+ *
+ * Nets are routed one after the other with an A* search per sink, starting from all wires already in the net's
+ * route tree. Wires may be used by several nets at once; the cost of a wire is its delay scaled by a history term,
+ * which accumulates overuse over iterations, and a present term, which grows with the number of other nets currently
+ * using it. After the first iteration only nets that use an overused wire are ripped up and rerouted, and the
+ * present cost factor is increased every iteration until no wire is shared.
+ *
+ * Routing is tracked in the router's own per-wire arrays and only bound to the Arch at the end, as the Arch binding
+ * API can't represent overused wires.
+ *
+ * With more than one thread, the device is split into vertical strips. Nets whose bounding box (plus a margin)
+ * lies within a single strip are routed concurrently, one thread per strip, with the search confined to wires in
+ * that strip so that threads never touch the same wire. The remaining nets, and any that couldn't be routed within
+ * their strip, are then routed serially. Each strip has its own RNG, seeded in a fixed order, so results only depend
+ * on the seed and thread count.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <thread>
+
+#include "log.h"
+#include "router_pathfinder.h"
+#include "timing.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+namespace {
+
+struct PathfinderNet
+{
+    NetInfo *net_info;
+    WireId src_wire;
+    // Distinct sink wires, nearest first so that the route tree grows outwards from the source
+    std::vector<WireId> sink_wires;
+    // Current route of the net: each wire with the pip driving it (PipId() for the source wire)
+    std::vector<std::pair<WireId, PipId>> tree;
+    // Locked routing that is kept bound in the Arch; always the first entries of the tree
+    std::vector<std::pair<WireId, PipId>> fixed;
+    // Index of the strip that contains the net, or -1 if it must be routed serially
+    int region = -1;
+};
+
+struct PathfinderWire
+{
+    // Number of nets whose current route uses the wire
+    int occupancy = 0;
+    float history = 0;
+    // Search state, only valid if visit_epoch matches the router's current search
+    uint32_t visit_epoch = 0;
+    PipId pip;
+    float cost = 0;
+    // Equal to the router's tree epoch if the wire is part of the net currently being routed
+    uint32_t tree_epoch = 0;
+};
+
+struct QueuedWire
+{
+    WireId wire;
+    float cost = 0, score = 0;
+    int randtag = 0;
+
+    struct Greater
+    {
+        bool operator()(const QueuedWire &lhs, const QueuedWire &rhs) const noexcept
+        {
+            return lhs.score == rhs.score ? lhs.randtag > rhs.randtag : lhs.score > rhs.score;
+        }
+    };
+};
+
+// Per-thread routing state. Search and tree epochs are drawn from a counter shared by all workers, so that a stale
+// stamp left on a wire by one worker can never match the current search of another
+struct PathfinderWorker
+{
+    DeterministicRNG rng;
+    std::vector<QueuedWire> queue;
+    uint32_t visit_epoch = 0, tree_epoch = 0;
+    // Only wires with a location inside this column range are used
+    int x0 = 0, x1 = std::numeric_limits<int>::max();
+    // Nets to route in the current iteration
+    std::vector<PathfinderNet *> nets;
+    // Set if routing failed, for reporting once the worker is done
+    PathfinderNet *failed_net = nullptr;
+    WireId failed_wire;
+    // Nets that couldn't be routed inside the worker's strip, to be retried serially
+    std::vector<PathfinderNet *> demoted;
+};
+
+struct PathfinderRouter
+{
+    Context *ctx;
+    const RouterPathfinderCfg &cfg;
+
+    std::vector<PathfinderNet> nets;
+    // Indexed by ctx->getWireFlatIndex
+    std::vector<PathfinderWire> wires;
+    std::atomic<uint32_t> epoch_counter{0};
+    float present_cost;
+
+    // One worker per strip, plus the worker used for serial routing
+    std::vector<PathfinderWorker> region_workers;
+    PathfinderWorker serial_worker;
+    // Minimum width of a strip, and the distance a net's bounding box must keep from the strip edges
+    const int min_region_width = 12;
+    const int region_margin = 3;
+
+    PathfinderRouter(Context *ctx, const RouterPathfinderCfg &cfg)
+            : ctx(ctx), cfg(cfg), present_cost(cfg.presentCostInit)
+    {
+        wires.resize(ctx->getWireFlatIndexCount());
+    }
+
+    PathfinderWire &wire_data(WireId wire) { return wires[ctx->getWireFlatIndex(wire)]; }
+
+    uint32_t next_epoch() { return ++epoch_counter; }
+
+    // Must be called while no worker is running; clears all stamps well before the epoch counter can wrap
+    void check_epoch_wrap()
+    {
+        if (epoch_counter < (1u << 31))
+            return;
+        for (auto &w : wires) {
+            w.visit_epoch = 0;
+            w.tree_epoch = 0;
+        }
+        epoch_counter = 0;
+    }
+
+    void setup_regions()
+    {
+        int width = ctx->getGridDimX();
+        int n_regions = std::max(1, std::min(ctx->threads, width / min_region_width));
+        if (n_regions == 1)
+            return;
+        region_workers.resize(n_regions);
+        for (int i = 0; i < n_regions; i++) {
+            auto &w = region_workers.at(i);
+            w.x0 = (i * width) / n_regions;
+            w.x1 = ((i + 1) * width) / n_regions - 1;
+            w.queue.reserve(1 << 16);
+            // Seeds are drawn serially in region order, so results don't depend on thread scheduling
+            w.rng.rngseed(ctx->rng64());
+        }
+
+        for (auto &net : nets) {
+            int xmin = std::numeric_limits<int>::max(), xmax = std::numeric_limits<int>::min();
+            auto extend = [&](WireId w) {
+                int x = ctx->getWireLocation(w).x;
+                xmin = std::min(xmin, x);
+                xmax = std::max(xmax, x);
+            };
+            extend(net.src_wire);
+            for (WireId dst_wire : net.sink_wires)
+                extend(dst_wire);
+            // Locked wires are added to the tree by the worker, so must be inside the strip as well
+            for (auto &f : net.fixed)
+                extend(f.first);
+            for (int i = 0; i < n_regions; i++) {
+                auto &w = region_workers.at(i);
+                if (xmin - region_margin >= w.x0 && xmax + region_margin <= w.x1) {
+                    net.region = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    bool skip_net(NetInfo *net_info)
+    {
+#ifdef ARCH_ECP5
+        // Global nets are routed by the arch-specific global router
+        if (net_info->is_global)
+            return true;
+#endif
+        if (net_info->driver.cell == nullptr)
+            return true;
+        if (net_info->users.empty())
+            return true;
+        return false;
+    }
+
+    // Collect the nets to route and discard any existing routing they have, except for locked wires
+    void setup()
+    {
+        std::vector<IdString> net_names;
+        for (auto &net_it : ctx->nets)
+            net_names.push_back(net_it.first);
+        ctx->sorted_shuffle(net_names);
+
+        for (IdString net_name : net_names) {
+            NetInfo *net_info = ctx->nets.at(net_name).get();
+            if (skip_net(net_info))
+                continue;
+
+            PathfinderNet net;
+            net.net_info = net_info;
+            net.src_wire = ctx->getNetinfoSourceWire(net_info);
+            if (net.src_wire == WireId())
+                log_error("No wire found for port %s on source cell %s.\n", ctx->nameOf(net_info->driver.port),
+                          ctx->nameOf(net_info->driver.cell));
+
+            for (auto &user : net_info->users) {
+                WireId dst_wire = ctx->getNetinfoSinkWire(net_info, user);
+                if (dst_wire == WireId())
+                    log_error("No wire found for port %s on destination cell %s.\n", ctx->nameOf(user.port),
+                              ctx->nameOf(user.cell));
+                if (dst_wire != net.src_wire &&
+                    std::find(net.sink_wires.begin(), net.sink_wires.end(), dst_wire) == net.sink_wires.end())
+                    net.sink_wires.push_back(dst_wire);
+            }
+            std::stable_sort(net.sink_wires.begin(), net.sink_wires.end(), [&](WireId a, WireId b) {
+                return ctx->estimateDelay(net.src_wire, a) < ctx->estimateDelay(net.src_wire, b);
+            });
+
+            // Locked wires are kept and seed the route tree, so they must connect back to the source through
+            // other locked wires
+            for (auto &it : net_info->wires) {
+                if (it.second.strength < STRENGTH_LOCKED)
+                    continue;
+                WireId cursor = it.first;
+                while (true) {
+                    auto fnd = net_info->wires.find(cursor);
+                    if (fnd == net_info->wires.end() || fnd->second.strength < STRENGTH_LOCKED)
+                        log_error("Locked wire %s on net %s is not driven from the source by locked routing.\n",
+                                  ctx->nameOfWire(it.first), ctx->nameOf(net_info));
+                    if (fnd->second.pip == PipId())
+                        break;
+                    cursor = ctx->getPipSrcWire(fnd->second.pip);
+                }
+                if (cursor != net.src_wire)
+                    log_error("Locked wire %s on net %s is not driven from the source by locked routing.\n",
+                              ctx->nameOfWire(it.first), ctx->nameOf(net_info));
+                net.fixed.emplace_back(it.first, it.second.pip);
+            }
+
+            std::vector<WireId> old_wires;
+            for (auto &it : net_info->wires)
+                if (it.second.strength < STRENGTH_LOCKED)
+                    old_wires.push_back(it.first);
+            for (WireId w : old_wires)
+                ctx->unbindWire(w);
+
+            nets.push_back(std::move(net));
+        }
+
+        serial_worker.queue.reserve(1 << 16);
+        serial_worker.rng.rngseed(ctx->rng64());
+        setup_regions();
+    }
+
+    void add_to_tree(PathfinderWorker &w, PathfinderNet &net, WireId wire, PipId pip)
+    {
+        auto &wd = wire_data(wire);
+        net.tree.emplace_back(wire, pip);
+        wd.occupancy++;
+        wd.tree_epoch = w.tree_epoch;
+    }
+
+    void ripup_net(PathfinderNet &net)
+    {
+        for (auto &t : net.tree)
+            wire_data(t.first).occupancy--;
+        net.tree.clear();
+    }
+
+    void push_queue(PathfinderWorker &w, WireId wire, float cost, WireId dst_wire)
+    {
+        QueuedWire qw;
+        qw.wire = wire;
+        qw.cost = cost;
+        qw.score = cost + cfg.estimateWeight * ctx->estimateDelay(wire, dst_wire);
+        qw.randtag = w.rng.rng();
+        w.queue.push_back(qw);
+        std::push_heap(w.queue.begin(), w.queue.end(), QueuedWire::Greater());
+    }
+
+    // Find the cheapest path from the net's route tree to dst_wire and add it to the tree
+    bool route_sink(PathfinderWorker &w, PathfinderNet &net, WireId dst_wire)
+    {
+        w.visit_epoch = next_epoch();
+        w.queue.clear();
+
+        for (auto &t : net.tree) {
+            auto &wd = wire_data(t.first);
+            wd.visit_epoch = w.visit_epoch;
+            wd.pip = PipId();
+            wd.cost = 0;
+            push_queue(w, t.first, 0, dst_wire);
+        }
+
+        bool found = false;
+        while (!w.queue.empty()) {
+            std::pop_heap(w.queue.begin(), w.queue.end(), QueuedWire::Greater());
+            QueuedWire qw = w.queue.back();
+            w.queue.pop_back();
+
+            if (qw.cost > wire_data(qw.wire).cost)
+                continue;
+            if (qw.wire == dst_wire) {
+                found = true;
+                break;
+            }
+
+            for (auto pip : ctx->getPipsDownhill(qw.wire)) {
+                WireId next_wire = ctx->getPipDstWire(pip);
+                int x = ctx->getWireLocation(next_wire).x;
+                if (x < w.x0 || x > w.x1)
+                    continue;
+                auto &nd = wire_data(next_wire);
+                if (nd.tree_epoch == w.tree_epoch)
+                    continue;
+                if (!ctx->checkWireAvail(next_wire) || !ctx->checkPipAvail(pip))
+                    continue;
+
+                float base = ctx->getPipDelay(pip).maxDelay() + ctx->getWireDelay(next_wire).maxDelay() +
+                             cfg.wireBaseCost;
+                float next_cost = qw.cost + base * (1 + nd.history) * (1 + present_cost * nd.occupancy);
+                if (nd.visit_epoch == w.visit_epoch && nd.cost <= next_cost)
+                    continue;
+
+                nd.visit_epoch = w.visit_epoch;
+                nd.pip = pip;
+                nd.cost = next_cost;
+                push_queue(w, next_wire, next_cost, dst_wire);
+            }
+        }
+
+        if (!found)
+            return false;
+
+        WireId cursor = dst_wire;
+        while (wire_data(cursor).tree_epoch != w.tree_epoch) {
+            PipId pip = wire_data(cursor).pip;
+            NPNR_ASSERT(pip != PipId());
+            add_to_tree(w, net, cursor, pip);
+            cursor = ctx->getPipSrcWire(pip);
+        }
+        return true;
+    }
+
+    bool route_net(PathfinderWorker &w, PathfinderNet &net)
+    {
+        ripup_net(net);
+        w.tree_epoch = next_epoch();
+        if (net.fixed.empty())
+            add_to_tree(w, net, net.src_wire, PipId());
+        for (auto &f : net.fixed)
+            add_to_tree(w, net, f.first, f.second);
+
+        for (WireId dst_wire : net.sink_wires) {
+            if (wire_data(dst_wire).tree_epoch == w.tree_epoch)
+                continue;
+            if (!route_sink(w, net, dst_wire)) {
+                w.failed_net = &net;
+                w.failed_wire = dst_wire;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool route_worker_nets(PathfinderWorker &w)
+    {
+        for (auto net : w.nets) {
+            if (route_net(w, *net))
+                continue;
+            if (&w == &serial_worker)
+                return false;
+            // The strip may just be too congested near its edges, so let the serial pass route the net without
+            // the strip bounds instead
+            ripup_net(*net);
+            w.failed_net = nullptr;
+            w.demoted.push_back(net);
+        }
+        return true;
+    }
+
+    // Reroute the given nets, strip-local ones in parallel first. Returns false if a net couldn't be routed
+    bool route_nets(const std::vector<PathfinderNet *> &to_route)
+    {
+        check_epoch_wrap();
+        serial_worker.nets.clear();
+        for (auto &w : region_workers) {
+            w.nets.clear();
+            w.demoted.clear();
+        }
+        for (auto net : to_route) {
+            if (net->region == -1)
+                serial_worker.nets.push_back(net);
+            else
+                region_workers.at(net->region).nets.push_back(net);
+        }
+
+        if (!region_workers.empty()) {
+            std::vector<std::thread> threads;
+            std::vector<std::exception_ptr> errors(region_workers.size());
+            for (int i = 0; i < int(region_workers.size()); i++) {
+                threads.emplace_back([this, i, &errors]() {
+                    try {
+                        route_worker_nets(region_workers.at(i));
+                    } catch (...) {
+                        errors.at(i) = std::current_exception();
+                    }
+                });
+            }
+            for (auto &t : threads)
+                t.join();
+            for (auto &e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+
+            // Demoted nets stay serial for the remaining iterations
+            int n_demoted = 0;
+            for (auto &w : region_workers) {
+                for (auto net : w.demoted) {
+                    net->region = -1;
+                    serial_worker.nets.push_back(net);
+                    n_demoted++;
+                }
+            }
+            if (n_demoted > 0 && ctx->verbose)
+                log_info("    %d nets could not be routed within their strip, routing them serially\n", n_demoted);
+        }
+
+        route_worker_nets(serial_worker);
+
+        bool ok = true;
+        for (auto w : get_workers()) {
+            if (w->failed_net != nullptr) {
+                log_warning("Failed to find a route from %s to %s on net %s.\n",
+                            ctx->nameOfWire(w->failed_net->src_wire), ctx->nameOfWire(w->failed_wire),
+                            ctx->nameOf(w->failed_net->net_info));
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    std::vector<PathfinderWorker *> get_workers()
+    {
+        std::vector<PathfinderWorker *> workers;
+        for (auto &w : region_workers)
+            workers.push_back(&w);
+        workers.push_back(&serial_worker);
+        return workers;
+    }
+
+    bool is_overused(const PathfinderNet &net)
+    {
+        for (auto &t : net.tree)
+            if (wire_data(t.first).occupancy > 1)
+                return true;
+        return false;
+    }
+
+    // Returns the number of overused wires, and adds their overuse to their history cost
+    int update_history()
+    {
+        int overused = 0;
+        for (auto &w : wires) {
+            if (w.occupancy > 1) {
+                overused++;
+                w.history += cfg.historyCostMult * (w.occupancy - 1);
+            }
+        }
+        return overused;
+    }
+
+    void bind_routes()
+    {
+        for (auto &net : nets) {
+            // The locked part of the tree is still bound
+            for (size_t i = net.fixed.size(); i < net.tree.size(); i++) {
+                auto &t = net.tree.at(i);
+                if (t.second == PipId())
+                    ctx->bindWire(t.first, net.net_info, STRENGTH_WEAK);
+                else
+                    ctx->bindPip(t.second, net.net_info, STRENGTH_WEAK);
+            }
+        }
+    }
+};
+
+} // namespace
+
+RouterPathfinderCfg::RouterPathfinderCfg(Context *ctx) : Settings(ctx)
+{
+    maxIterCnt = get<int>("pathfinder/maxIterCnt", 50);
+    presentCostInit = get<float>("pathfinder/presentCostInit", 0.5);
+    presentCostMult = get<float>("pathfinder/presentCostMult", 1.5);
+    historyCostMult = get<float>("pathfinder/historyCostMult", 0.2);
+    estimateWeight = get<float>("pathfinder/estimateWeight", 1.0);
+
+    wireBaseCost = ctx->getDelayEpsilon();
+}
+
+bool router_pathfinder(Context *ctx, const RouterPathfinderCfg &cfg)
+{
+    try {
+        log_break();
+        log_info("Routing (PathFinder)..\n");
+        ctx->lock();
+        auto rstart = std::chrono::high_resolution_clock::now();
+
+        PathfinderRouter router(ctx, cfg);
+        router.setup();
+
+        int arc_count = 0;
+        for (auto &net : router.nets)
+            arc_count += int(net.sink_wires.size());
+        log_info("Routing %d nets with %d sink wires.\n", int(router.nets.size()), arc_count);
+        if (!router.region_workers.empty()) {
+            int local_count = 0;
+            for (auto &net : router.nets)
+                if (net.region != -1)
+                    local_count++;
+            log_info("Routing %d nets in parallel on %d threads, %d serially.\n", local_count,
+                     int(router.region_workers.size()), int(router.nets.size()) - local_count);
+        }
+
+        log_info("      Iter | rerouted nets | overused wires\n");
+
+        for (int iter = 1;; iter++) {
+            std::vector<PathfinderNet *> to_route;
+            for (auto &net : router.nets)
+                if (iter == 1 || router.is_overused(net))
+                    to_route.push_back(&net);
+            if (!router.route_nets(to_route)) {
+                ctx->unlock();
+                return false;
+            }
+            int rerouted = int(to_route.size());
+
+            int overused = router.update_history();
+            log_info("%10d | %13d | %14d\n", iter, rerouted, overused);
+
+            if (overused == 0)
+                break;
+            if (iter >= cfg.maxIterCnt) {
+                log_warning("Failed to resolve routing congestion after %d iterations, %d wires overused.\n", iter,
+                            overused);
+                ctx->unlock();
+                return false;
+            }
+            router.present_cost *= cfg.presentCostMult;
+            ctx->yield();
+        }
+
+        router.bind_routes();
+        log_info("Routing complete.\n");
+        auto rend = std::chrono::high_resolution_clock::now();
+        ctx->yield();
+        log_info("Route time %.02fs\n", std::chrono::duration<float>(rend - rstart).count());
+
+        if (!ctx->checkRoutedDesign()) {
+            log_warning("Routed design failed the consistency check.\n");
+            ctx->unlock();
+            return false;
+        }
+
+        log_info("Checksum: 0x%08x\n", ctx->checksum());
+        timing_analysis(ctx, true /* slack_histogram */, true /* print_fmax */, true /* print_path */,
+                        true /* warn_on_failure */);
+
+        ctx->unlock();
+        return true;
+    } catch (log_execution_error_exception) {
+#ifndef NDEBUG
+        ctx->check();
+#endif
+        ctx->unlock();
+        return false;
+    }
+}
+
+NEXTPNR_NAMESPACE_END
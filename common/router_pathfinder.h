@@ -0,0 +1,51 @@
+/*
+ *  nextpnr -- Next Generation Place and Route
+ *
+ *  Copyright (C) 2018  SymbioticEDA
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef ROUTER_PATHFINDER_H
+#define ROUTER_PATHFINDER_H
+
+#include "nextpnr.h"
+#include "settings.h"
+
+NEXTPNR_NAMESPACE_BEGIN
+
+struct RouterPathfinderCfg : Settings
+{
+    RouterPathfinderCfg(Context *ctx);
+    // Give up if wires are still overused after this many iterations
+    int maxIterCnt;
+    // Present congestion factor for the first iteration, and its growth per iteration
+    float presentCostInit;
+    float presentCostMult;
+    // Increase of the history cost of a wire per unit of overuse at the end of each iteration
+    float historyCostMult;
+    // Weight of the delay estimate to the sink in the A* search
+    float estimateWeight;
+    // Cost added to every wire on top of its delay, so that zero-delay wires aren't free
+    delay_t wireBaseCost;
+};
+
+// Route all nets using negotiated congestion: every iteration nets are routed while allowing wires to be shared,
+// then the cost of shared wires is raised until no wire is used by more than one net. The result is only bound to
+// the Arch once it is legal.
+extern bool router_pathfinder(Context *ctx, const RouterPathfinderCfg &cfg);
+
+NEXTPNR_NAMESPACE_END
+
+#endif // ROUTER_PATHFINDER_H
@@ -58,6 +58,18 @@ class Settings
     Context *ctx;
 };
 
+template <> inline std::string Settings::get<std::string>(const char *name, std::string defaultValue)
+{
+    IdString id = ctx->id(name);
+    auto pair = ctx->settings.emplace(id, defaultValue);
+    return pair.first->second;
+}
+
+template <> inline void Settings::set<std::string>(const char *name, std::string value)
+{
+    ctx->settings[ctx->id(name)] = value;
+}
+
 NEXTPNR_NAMESPACE_END
 
 #endif // SETTINGS_H
@@ -696,6 +696,12 @@ void assign_budget(Context *ctx, bool quiet)
         log_info("Checksum: 0x%08x\n", ctx->checksum());
 }
 
+delay_t get_worst_slack(Context *ctx)
+{
+    Timing timing(ctx, true /* net_delays */, false /* update */);
+    return timing.walk_paths();
+}
+
 void timing_analysis(Context *ctx, bool print_histogram, bool print_fmax, bool print_path, bool warn_on_failure)
 {
     auto format_event = [ctx](const ClockEvent &e, int field_width = 0) {
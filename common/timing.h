@@ -42,6 +42,9 @@ struct NetCriticalityInfo
     delay_t cd_worst_slack = std::numeric_limits<delay_t>::max();
 };
 
+// Return the worst slack across all paths, relative to the target frequency
+delay_t get_worst_slack(Context *ctx);
+
 typedef std::unordered_map<IdString, NetCriticalityInfo> NetCriticalityMap;
 void get_criticalities(Context *ctx, NetCriticalityMap *net_crit);
 
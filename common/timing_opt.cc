@@ -29,8 +29,11 @@
  */
 
 #include "timing_opt.h"
+#include <atomic>
 #include <boost/range/adaptor/reversed.hpp>
+#include <exception>
 #include <queue>
+#include <thread>
 #include "nextpnr.h"
 #include "timing.h"
 #include "util.h"
@@ -91,8 +94,15 @@ class TimingOptimiser
             get_criticalities(ctx, &net_crit);
             setup_delay_limits();
             auto crit_paths = find_crit_paths(0.98, 50000);
-            for (auto &path : crit_paths)
-                optimise_path(path);
+            // Debug logging creates IdStrings for bel names, which is not thread safe
+            if (ctx->threads > 1 && !ctx->debug) {
+                optimise_paths_parallel(crit_paths);
+            } else {
+                PathWorker w;
+                w.rng = ctx;
+                for (auto &path : crit_paths)
+                    optimise_path(w, path);
+            }
             if (ctx->verbose)
                 timing_analysis(ctx, false, true, false, false);
         }
@@ -100,6 +110,34 @@ class TimingOptimiser
     }
 
   private:
+    // Scratch state for optimising one path at a time. The serial optimiser uses the context RNG; parallel
+    // workers reseed their own RNG for every path so results don't depend on thread scheduling
+    struct PathWorker
+    {
+        DeterministicRNG *rng = nullptr;
+        DeterministicRNG path_rng;
+        // Current candidate Bels for cells (linked in both direction>
+        std::vector<IdString> path_cells;
+        std::unordered_map<IdString, std::unordered_set<BelId>> cell_neighbour_bels;
+        std::unordered_map<BelId, std::unordered_set<IdString>> bel_candidate_cells;
+    };
+
+    // Tiles (as flat indices) an optimise_path call may move cells within, and tiles holding cells whose location
+    // its delay checks may read. Paths can be optimised concurrently if neither writes what the other touches
+    struct PathFootprint
+    {
+        std::unordered_set<int> write, read;
+    };
+
+    // Search window radius around each path cell (FIXME: how to best determine d)
+    static const int window_d = 2;
+
+    bool can_move(const CellInfo *cell) const
+    {
+        return cell->belStrength <= STRENGTH_WEAK && cfg.cellTypes.count(cell->type) &&
+               cell->constr_parent == nullptr && cell->constr_children.empty();
+    }
+
     void setup_delay_limits()
     {
         max_net_delay.clear();
@@ -199,8 +237,10 @@ class TimingOptimiser
         return true;
     }
 
-    int find_neighbours(CellInfo *cell, IdString prev_cell, int d, bool allow_swap)
+    int find_neighbours(PathWorker &w, CellInfo *cell, IdString prev_cell, int d, bool allow_swap)
     {
+        auto &cell_neighbour_bels = w.cell_neighbour_bels;
+        auto &bel_candidate_cells = w.bel_candidate_cells;
         BelId curr = cell->bel;
         Loc curr_loc = ctx->getBelLocation(curr);
         int found_count = 0;
@@ -229,11 +269,11 @@ class TimingOptimiser
                 while (!free_bels_at_loc.empty() || !bound_bels_at_loc.empty()) {
                     BelId try_bel;
                     if (!free_bels_at_loc.empty()) {
-                        int try_idx = ctx->rng(int(free_bels_at_loc.size()));
+                        int try_idx = w.rng->rng(int(free_bels_at_loc.size()));
                         try_bel = free_bels_at_loc.at(try_idx);
                         free_bels_at_loc.erase(free_bels_at_loc.begin() + try_idx);
                     } else {
-                        int try_idx = ctx->rng(int(bound_bels_at_loc.size()));
+                        int try_idx = w.rng->rng(int(bound_bels_at_loc.size()));
                         try_bel = bound_bels_at_loc.at(try_idx);
                         bound_bels_at_loc.erase(bound_bels_at_loc.begin() + try_idx);
                     }
@@ -399,11 +439,151 @@ class TimingOptimiser
         return crit_paths;
     }
 
-    void optimise_path(std::vector<PortRef *> &path)
+    PathFootprint get_footprint(const std::vector<PortRef *> &path)
+    {
+        PathFootprint fp;
+        const int w = ctx->getGridDimX(), h = ctx->getGridDimY();
+        auto tile_of = [&](const CellInfo *cell) {
+            Loc loc = ctx->getBelLocation(cell->bel);
+            return loc.y * w + loc.x;
+        };
+        auto add_read = [&](const CellInfo *cell) {
+            if (cell != nullptr && cell->bel != BelId())
+                fp.read.insert(tile_of(cell));
+        };
+
+        std::vector<const CellInfo *> movable;
+        for (auto port : path) {
+            NetInfo *pn = port->cell->ports.at(port->port).net;
+            add_read(port->cell);
+            if (pn != nullptr)
+                add_read(pn->driver.cell);
+            if (can_move(port->cell))
+                movable.push_back(port->cell);
+            if (port == path.front() && pn != nullptr && pn->driver.cell != nullptr && can_move(pn->driver.cell))
+                movable.push_back(pn->driver.cell);
+        }
+
+        for (auto cell : movable) {
+            Loc loc = ctx->getBelLocation(cell->bel);
+            for (int y = std::max(0, loc.y - window_d); y <= std::min(h - 1, loc.y + window_d); y++)
+                for (int x = std::max(0, loc.x - window_d); x <= std::min(w - 1, loc.x + window_d); x++)
+                    fp.write.insert(y * w + x);
+        }
+
+        // Any cell of a movable type in the window may be swapped, after which the delay of every connection that
+        // check_cell_delay_limits looks at is re-estimated
+        for (int tile : fp.write) {
+            for (auto bel : ctx->getBelsByTile(tile % w, tile / w)) {
+                CellInfo *bound = ctx->getBoundBelCell(bel);
+                if (bound == nullptr || !cfg.cellTypes.count(bound->type))
+                    continue;
+                for (const auto &port : bound->ports) {
+                    NetInfo *net = port.second.net;
+                    if (net == nullptr)
+                        continue;
+                    int nc;
+                    if (ctx->getPortTimingClass(bound, port.first, nc) == TMG_IGNORE)
+                        continue;
+                    if (port.second.type == PORT_IN) {
+                        add_read(net->driver.cell);
+                    } else if (port.second.type == PORT_OUT) {
+                        for (auto &usr : net->users)
+                            add_read(usr.cell);
+                    }
+                }
+            }
+        }
+        return fp;
+    }
+
+    void optimise_paths_parallel(std::vector<std::vector<PortRef *>> &paths)
+    {
+        const size_t max_batch = size_t(ctx->threads) * 8;
+        // The UI is fully refreshed afterwards, so workers never need to touch the per-bel refresh set
+        ctx->refreshUi();
+
+        std::vector<std::vector<PortRef *> *> remaining;
+        for (auto &path : paths)
+            remaining.push_back(&path);
+
+        int n_batches = 0;
+        while (!remaining.empty()) {
+            // Greedily build a batch of paths whose footprints don't conflict. Footprints are recomputed for every
+            // batch, as earlier batches will have moved cells around
+            std::vector<std::vector<PortRef *> *> batch, deferred;
+            std::unordered_set<int> batch_write, batch_read;
+            for (auto path : remaining) {
+                if (batch.size() >= max_batch) {
+                    deferred.push_back(path);
+                    continue;
+                }
+                PathFootprint fp = get_footprint(*path);
+                bool conflict = false;
+                for (int t : fp.write)
+                    if (batch_write.count(t) || batch_read.count(t)) {
+                        conflict = true;
+                        break;
+                    }
+                if (!conflict)
+                    for (int t : fp.read)
+                        if (batch_write.count(t)) {
+                            conflict = true;
+                            break;
+                        }
+                if (conflict) {
+                    deferred.push_back(path);
+                    continue;
+                }
+                batch.push_back(path);
+                batch_write.insert(fp.write.begin(), fp.write.end());
+                batch_read.insert(fp.read.begin(), fp.read.end());
+            }
+            NPNR_ASSERT(!batch.empty());
+
+            std::vector<uint64_t> seeds;
+            for (size_t i = 0; i < batch.size(); i++)
+                seeds.push_back(ctx->rng64());
+
+            int n_threads = std::min(ctx->threads, int(batch.size()));
+            std::atomic<size_t> next_path(0);
+            std::vector<std::thread> threads;
+            std::vector<std::exception_ptr> errors(n_threads);
+            for (int i = 0; i < n_threads; i++) {
+                threads.emplace_back([this, i, &batch, &seeds, &next_path, &errors]() {
+                    try {
+                        PathWorker w;
+                        w.rng = &w.path_rng;
+                        size_t idx;
+                        while ((idx = next_path++) < batch.size()) {
+                            w.path_rng.rngseed(seeds.at(idx));
+                            optimise_path(w, *batch.at(idx));
+                        }
+                    } catch (...) {
+                        errors.at(i) = std::current_exception();
+                    }
+                });
+            }
+            for (auto &t : threads)
+                t.join();
+            for (auto &e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+
+            remaining = std::move(deferred);
+            n_batches++;
+        }
+        if (ctx->verbose)
+            log_info("      optimised %d paths in %d batches\n", int(paths.size()), n_batches);
+    }
+
+    void optimise_path(PathWorker &w, std::vector<PortRef *> &path)
     {
+        auto &path_cells = w.path_cells;
+        auto &cell_neighbour_bels = w.cell_neighbour_bels;
         path_cells.clear();
         cell_neighbour_bels.clear();
-        bel_candidate_cells.clear();
+        w.bel_candidate_cells.clear();
         if (ctx->debug)
             log_info("Optimising the following path: \n");
 
@@ -411,8 +591,7 @@ class TimingOptimiser
         NetInfo *front_net = front_port->cell->ports.at(front_port->port).net;
         if (front_net != nullptr && front_net->driver.cell != nullptr) {
             auto front_cell = front_net->driver.cell;
-            if (front_cell->belStrength <= STRENGTH_WEAK && cfg.cellTypes.count(front_cell->type) &&
-                front_cell->constr_parent == nullptr && front_cell->constr_children.empty()) {
+            if (can_move(front_cell)) {
                 path_cells.push_back(front_cell->name);
             }
         }
@@ -430,8 +609,7 @@ class TimingOptimiser
             }
             if (std::find(path_cells.begin(), path_cells.end(), port->cell->name) != path_cells.end())
                 continue;
-            if (port->cell->belStrength > STRENGTH_WEAK || !cfg.cellTypes.count(port->cell->type) ||
-                port->cell->constr_parent != nullptr || !port->cell->constr_children.empty())
+            if (!can_move(port->cell))
                 continue;
             if (ctx->debug)
                 log_info("        can move\n");
@@ -462,17 +640,16 @@ class TimingOptimiser
         }
 
         IdString last_cell;
-        const int d = 2; // FIXME: how to best determine d
         for (auto cell : path_cells) {
             // FIXME: when should we allow swapping due to a lack of candidates
-            find_neighbours(ctx->cells[cell].get(), last_cell, d, false);
+            find_neighbours(w, ctx->cells.at(cell).get(), last_cell, window_d, false);
             last_cell = cell;
         }
 
         if (ctx->debug) {
             for (auto cell : path_cells) {
                 log_info("Candidate neighbours for %s (%s):\n", cell.c_str(ctx),
-                         ctx->getBelName(ctx->cells[cell]->bel).c_str(ctx));
+                         ctx->getBelName(ctx->cells.at(cell)->bel).c_str(ctx));
                 for (auto neigh : cell_neighbour_bels.at(cell)) {
                     log_info("    %s\n", ctx->getBelName(neigh).c_str(ctx));
                 }
@@ -607,10 +784,6 @@ class TimingOptimiser
             log_break();
     }
 
-    // Current candidate Bels for cells (linked in both direction>
-    std::vector<IdString> path_cells;
-    std::unordered_map<IdString, std::unordered_set<BelId>> cell_neighbour_bels;
-    std::unordered_map<BelId, std::unordered_set<IdString>> bel_candidate_cells;
     // Map cell ports to net delay limit
     std::unordered_map<std::pair<IdString, IdString>, delay_t> max_net_delay;
     // Criticality data from timing analysis
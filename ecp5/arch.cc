@@ -28,8 +28,11 @@
 #include "log.h"
 #include "nextpnr.h"
 #include "placer1.h"
+#include "route_eco.h"
 #include "router1.h"
+#include "router_pathfinder.h"
 #include "timing.h"
+#include "timing_opt.h"
 #include "util.h"
 
 NEXTPNR_NAMESPACE_BEGIN
@@ -128,6 +131,24 @@ Arch::Arch(ArchArgs args) : args(args)
         log_error("Unsupported package '%s' for '%s'.\n", args.package.c_str(), getChipName().c_str());
 
     bel_to_cell.resize(chip_info->height * chip_info->width * max_loc_bels, nullptr);
+    tile_slice_state.resize(chip_info->height * chip_info->width);
+
+    int num_tiles = chip_info->height * chip_info->width;
+    tile_wire_offset.resize(num_tiles + 1);
+    tile_pip_offset.resize(num_tiles + 1);
+    for (int i = 0; i < num_tiles; i++) {
+        const auto &loc = chip_info->locations[chip_info->location_type[i]];
+        tile_wire_offset[i + 1] = tile_wire_offset[i] + loc.num_wires;
+        tile_pip_offset[i + 1] = tile_pip_offset[i] + loc.num_pips;
+    }
+    wire_state.resize(tile_wire_offset[num_tiles]);
+
+    for (auto bel : getBels()) {
+        IdString type = getBelType(bel);
+        if (type.index >= int(bels_by_type.size()))
+            bels_by_type.resize(type.index + 1);
+        bels_by_type[type.index].push_back(bel);
+    }
 }
 
 // -----------------------------------------------------------------------
@@ -157,6 +178,57 @@ std::string Arch::getChipName() const
     }
 }
 
+static uint32_t chipdb_xorshift32(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+uint32_t Arch::getChipdbChecksum() const
+{
+    uint32_t cksum = chipdb_xorshift32(123456789);
+    auto mix = [&](uint32_t v) { cksum = chipdb_xorshift32(cksum + chipdb_xorshift32(v)); };
+    auto mix_str = [&](const char *str) {
+        for (; *str; str++)
+            mix(uint8_t(*str));
+        mix(0);
+    };
+
+    mix(chip_info->width);
+    mix(chip_info->height);
+    mix(chip_info->num_location_types);
+    for (int i = 0; i < chip_info->width * chip_info->height; i++)
+        mix(chip_info->location_type[i]);
+
+    // Only the distinct location types need hashing, tiles just refer to them
+    for (int i = 0; i < chip_info->num_location_types; i++) {
+        const LocationTypePOD &loc = chip_info->locations[i];
+        mix(loc.num_bels);
+        mix(loc.num_wires);
+        mix(loc.num_pips);
+        for (int j = 0; j < loc.num_bels; j++) {
+            mix_str(loc.bel_data[j].name.get());
+            mix(loc.bel_data[j].type);
+            mix(loc.bel_data[j].z);
+        }
+        for (int j = 0; j < loc.num_wires; j++)
+            mix_str(loc.wire_data[j].name.get());
+        for (int j = 0; j < loc.num_pips; j++) {
+            const PipInfoPOD &pip = loc.pip_data[j];
+            mix(pip.rel_src_loc.x);
+            mix(pip.rel_src_loc.y);
+            mix(pip.rel_dst_loc.x);
+            mix(pip.rel_dst_loc.y);
+            mix(pip.src_idx);
+            mix(pip.dst_idx);
+            mix(pip.pip_type);
+        }
+    }
+    return cksum;
+}
+
 // -----------------------------------------------------------------------
 
 IdString Arch::archArgsToId(ArchArgs args) const
@@ -224,6 +296,14 @@ BelRange Arch::getBelsByTile(int x, int y) const
     return br;
 }
 
+const std::vector<BelId> &Arch::getBelsByType(IdString type) const
+{
+    static const std::vector<BelId> no_bels;
+    if (type.index < 0 || type.index >= int(bels_by_type.size()))
+        return no_bels;
+    return bels_by_type[type.index];
+}
+
 WireId Arch::getBelPinWire(BelId bel, IdString pin) const
 {
     WireId ret;
@@ -427,6 +507,9 @@ BelId Arch::getBelByLocation(Loc loc) const
 
 delay_t Arch::estimateDelay(WireId src, WireId dst) const
 {
+    if (src == dst)
+        return 0;
+
     WireId cursor = dst;
 
     int num_uh = locInfo(dst)->wire_data[dst.index].num_uphill;
@@ -437,6 +520,18 @@ delay_t Arch::estimateDelay(WireId src, WireId dst) const
         }
     }
 
+    // The delay lookahead from the chipdb holds the delay from this class of wire to the nearest bel input at the
+    // offset of dst, so it's only a bound when dst is a bel pin itself
+    if (speed_grade->num_lookahead_classes > 0 && locInfo(dst)->wire_data[dst.index].num_bel_pins > 0) {
+        const auto &la = speed_grade->lookahead_classes[locInfo(src)->wire_data[src.index].lookahead_class];
+        int range = speed_grade->lookahead_range;
+        int dx = dst.location.x - src.location.x, dy = dst.location.y - src.location.y;
+        int cdx = std::max(-range, std::min(range, dx)), cdy = std::max(-range, std::min(range, dy));
+        uint16_t entry = la.delays[(cdy + range) * (2 * range + 1) + cdx + range];
+        if (entry != 0xFFFF)
+            return entry + (abs(dx - cdx) + abs(dy - cdy)) * la.delay_per_tile;
+    }
+
     auto est_location = [&](WireId w) -> std::pair<int, int> {
         const auto &wire = locInfo(w)->wire_data[w.index];
         if (wire.num_bel_pins > 0) {
@@ -507,6 +602,11 @@ bool Arch::getBudgetOverride(const NetInfo *net_info, const PortRef &sink, delay
 bool Arch::place()
 {
     bool result = placer1(getCtx(), Placer1Cfg(getCtx()));
+    if (result && bool_or_default(settings, id("timing/tmgRipup"), false)) {
+        TimingOptCfg tocfg(getCtx());
+        tocfg.cellTypes.insert(id_TRELLIS_SLICE);
+        result = timing_opt(getCtx(), tocfg);
+    }
     if (result)
         permute_luts();
     return result;
@@ -517,10 +617,27 @@ bool Arch::route()
     route_ecp5_globals(getCtx());
     assign_budget(getCtx(), true);
 
-    bool result = router1(getCtx(), Router1Cfg(getCtx()));
+    bool pathfinder = str_or_default(settings, id("router"), "router1") == "pathfinder";
+    std::string eco_routing = str_or_default(settings, id("route/ecoRouting"), "");
+    if (!eco_routing.empty()) {
+        // PathFinder rips up all existing routing, so only router1 can keep the restored nets
+        if (pathfinder)
+            log_warning("ECO routing is not supported by the PathFinder router, ignoring '%s'.\n",
+                        eco_routing.c_str());
+        else
+            restore_routing(getCtx(), eco_routing);
+    }
+
+    bool result;
+    if (pathfinder)
+        result = router_pathfinder(getCtx(), RouterPathfinderCfg(getCtx()));
+    else
+        result = router1(getCtx(), Router1Cfg(getCtx()));
 #if 0
     std::vector<std::pair<WireId, int>> fanout_vector;
-    std::copy(wire_fanout.begin(), wire_fanout.end(), std::back_inserter(fanout_vector));
+    for (auto wire : getWires())
+        if (wire_state[getWireFlatIndex(wire)].fanout > 0)
+            fanout_vector.emplace_back(wire, wire_state[getWireFlatIndex(wire)].fanout);
     std::sort(fanout_vector.begin(), fanout_vector.end(), [](const std::pair<WireId, int> &a, const std::pair<WireId, int> &b) {
         return a.second > b.second;
     });
@@ -529,17 +646,17 @@ bool Arch::route()
     log_break();
     PipId slowest_pip;
     delay_t slowest_pipdelay = 0;
-    for (auto pip : pip_to_net) {
-        if (pip.second) {
-            delay_t dly = getPipDelay(pip.first).maxDelay();
+    for (auto pip : getPips()) {
+        if (getBoundPipNet(pip)) {
+            delay_t dly = getPipDelay(pip).maxDelay();
             if (dly > slowest_pipdelay) {
-                slowest_pip = pip.first;
+                slowest_pip = pip;
                 slowest_pipdelay = dly;
             }
         }
     }
     log_info("    slowest pip %s = %.02f ns\n", getPipName(slowest_pip).c_str(this), getDelayNS(slowest_pipdelay));
-    log_info("       fanout %d\n", wire_fanout[getPipSrcWire(slowest_pip)]);
+    log_info("       fanout %d\n", wire_state[getWireFlatIndex(getPipSrcWire(slowest_pip))].fanout);
     log_info("       base %d adder %d\n", speed_grade->pip_classes[locInfo(slowest_pip)->pip_data[slowest_pip.index].timing_class].max_base_delay,
              speed_grade->pip_classes[locInfo(slowest_pip)->pip_data[slowest_pip.index].timing_class].max_fanout_adder);
 #endif
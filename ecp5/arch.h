@@ -89,6 +89,9 @@ NPNR_PACKED_STRUCT(struct WireInfoPOD {
 
     int32_t num_bel_pins;
     RelPtr<BelPortPOD> bel_pins;
+
+    int16_t lookahead_class;
+    int16_t padding;
 });
 
 NPNR_PACKED_STRUCT(struct LocationTypePOD {
@@ -182,11 +185,21 @@ NPNR_PACKED_STRUCT(struct PipDelayPOD {
     int32_t max_fanout_adder;
 });
 
+NPNR_PACKED_STRUCT(struct LookaheadClassPOD {
+    int32_t delay_per_tile;
+    // Smallest delay to a bel input wire at each offset, (2 * lookahead_range + 1)^2 entries, indexed by
+    // (dy + range) * (2 * range + 1) + dx + range
+    RelPtr<uint16_t> delays;
+});
+
 NPNR_PACKED_STRUCT(struct SpeedGradePOD {
     int32_t num_cell_timings;
     int32_t num_pip_classes;
     RelPtr<CellTimingPOD> cell_timings;
     RelPtr<PipDelayPOD> pip_classes;
+    int32_t lookahead_range;
+    int32_t num_lookahead_classes;
+    RelPtr<LookaheadClassPOD> lookahead_classes;
 });
 
 NPNR_PACKED_STRUCT(struct ChipInfoPOD {
@@ -459,14 +472,38 @@ struct Arch : BaseCtx
     mutable std::unordered_map<IdString, PipId> pip_by_name;
 
     std::vector<CellInfo *> bel_to_cell;
-    std::unordered_map<WireId, NetInfo *> wire_to_net;
-    std::unordered_map<PipId, NetInfo *> pip_to_net;
-    std::unordered_map<WireId, int> wire_fanout;
+
+    // Control set of the flip-flops bound in each tile, and how many bound cells use it. Cells with a
+    // different control set are counted as conflicts, which make the tile invalid
+    struct TileSliceState
+    {
+        IdString clk_sig, lsr_sig, clkmux, lsrmux, srmode;
+        int ref_count = 0;
+        int conflicts = 0;
+    };
+    std::vector<TileSliceState> tile_slice_state;
+    // All bels of each type, indexed by the type IdString
+    std::vector<std::vector<BelId>> bels_by_type;
+    // Routing state of each wire, indexed by getWireFlatIndex. Pips need no state of their own: a pip is bound
+    // exactly when its destination wire is bound through it
+    struct WireState
+    {
+        NetInfo *bound_net = nullptr;
+        // Flat index of the pip driving the wire, or -1 if it isn't bound or was bound directly
+        int32_t bound_pip = -1;
+        // Number of bound pips driven by the wire
+        int32_t fanout = 0;
+    };
+    std::vector<WireState> wire_state;
+    // Flat index of the first wire and pip of each tile
+    std::vector<int32_t> tile_wire_offset, tile_pip_offset;
 
     ArchArgs args;
     Arch(ArchArgs args);
 
     std::string getChipName() const;
+    // Hash of the routing graph and bels of the chip database, to check that saved bel and pip indices still apply
+    uint32_t getChipdbChecksum() const;
 
     IdString archId() const { return id("ecp5"); }
     ArchArgs archArgs() const { return args; }
@@ -478,6 +515,11 @@ struct Arch : BaseCtx
     int getGridDimY() const { return chip_info->height; };
     int getTileBelDimZ(int, int) const { return 4; };
     int getTilePipDimZ(int, int) const { return 1; };
+    // Number of pips in a tile, used as a measure of its routing capacity
+    int getTilePipCount(int x, int y) const
+    {
+        return chip_info->locations[chip_info->location_type[y * chip_info->width + x]].num_pips;
+    }
 
     // -------------------------------------------------
 
@@ -512,6 +554,8 @@ struct Arch : BaseCtx
         bel_to_cell[idx] = cell;
         cell->bel = bel;
         cell->belStrength = strength;
+        if (cell->type == id_TRELLIS_SLICE)
+            bindSliceState(bel, cell);
         refreshUiBel(bel);
     }
 
@@ -520,9 +564,12 @@ struct Arch : BaseCtx
         NPNR_ASSERT(bel != BelId());
         int idx = getBelFlatIndex(bel);
         NPNR_ASSERT(bel_to_cell.at(idx) != nullptr);
-        bel_to_cell[idx]->bel = BelId();
-        bel_to_cell[idx]->belStrength = STRENGTH_NONE;
+        CellInfo *cell = bel_to_cell[idx];
+        cell->bel = BelId();
+        cell->belStrength = STRENGTH_NONE;
         bel_to_cell[idx] = nullptr;
+        if (cell->type == id_TRELLIS_SLICE)
+            unbindSliceState(bel, cell);
         refreshUiBel(bel);
     }
 
@@ -537,6 +584,7 @@ struct Arch : BaseCtx
 
     BelId getBelByLocation(Loc loc) const;
     BelRange getBelsByTile(int x, int y) const;
+    const std::vector<BelId> &getBelsByType(IdString type) const;
 
     bool getBelGlobalBuf(BelId bel) const { return getBelType(bel) == id_DCCA; }
 
@@ -616,6 +664,15 @@ struct Arch : BaseCtx
 
     IdString getWireType(WireId wire) const { return IdString(); }
 
+    Loc getWireLocation(WireId wire) const
+    {
+        Loc loc;
+        loc.x = wire.location.x;
+        loc.y = wire.location.y;
+        loc.z = 0;
+        return loc;
+    }
+
     std::vector<std::pair<IdString, std::string>> getWireAttrs(WireId) const
     {
         std::vector<std::pair<IdString, std::string>> ret;
@@ -624,11 +681,21 @@ struct Arch : BaseCtx
 
     uint32_t getWireChecksum(WireId wire) const { return wire.index; }
 
+    int getWireFlatIndex(WireId wire) const
+    {
+        return tile_wire_offset[wire.location.y * chip_info->width + wire.location.x] + wire.index;
+    }
+
+    // Number of distinct values returned by getWireFlatIndex
+    int getWireFlatIndexCount() const { return int(wire_state.size()); }
+
     void bindWire(WireId wire, NetInfo *net, PlaceStrength strength)
     {
         NPNR_ASSERT(wire != WireId());
-        NPNR_ASSERT(wire_to_net[wire] == nullptr);
-        wire_to_net[wire] = net;
+        auto &ws = wire_state[getWireFlatIndex(wire)];
+        NPNR_ASSERT(ws.bound_net == nullptr);
+        ws.bound_net = net;
+        ws.bound_pip = -1;
         net->wires[wire].pip = PipId();
         net->wires[wire].strength = strength;
     }
@@ -636,35 +703,32 @@ struct Arch : BaseCtx
     void unbindWire(WireId wire)
     {
         NPNR_ASSERT(wire != WireId());
-        NPNR_ASSERT(wire_to_net[wire] != nullptr);
+        auto &ws = wire_state[getWireFlatIndex(wire)];
+        NPNR_ASSERT(ws.bound_net != nullptr);
 
-        auto &net_wires = wire_to_net[wire]->wires;
+        auto &net_wires = ws.bound_net->wires;
         auto it = net_wires.find(wire);
         NPNR_ASSERT(it != net_wires.end());
 
         auto pip = it->second.pip;
-        if (pip != PipId()) {
-            wire_fanout[getPipSrcWire(pip)]--;
-            pip_to_net[pip] = nullptr;
-        }
+        if (pip != PipId())
+            wire_state[getWireFlatIndex(getPipSrcWire(pip))].fanout--;
 
         net_wires.erase(it);
-        wire_to_net[wire] = nullptr;
+        ws.bound_net = nullptr;
+        ws.bound_pip = -1;
     }
 
     bool checkWireAvail(WireId wire) const
     {
         NPNR_ASSERT(wire != WireId());
-        return wire_to_net.find(wire) == wire_to_net.end() || wire_to_net.at(wire) == nullptr;
+        return wire_state[getWireFlatIndex(wire)].bound_net == nullptr;
     }
 
     NetInfo *getBoundWireNet(WireId wire) const
     {
         NPNR_ASSERT(wire != WireId());
-        if (wire_to_net.find(wire) == wire_to_net.end())
-            return nullptr;
-        else
-            return wire_to_net.at(wire);
+        return wire_state[getWireFlatIndex(wire)].bound_net;
     }
 
     WireId getConflictingWireWire(WireId wire) const { return wire; }
@@ -672,10 +736,7 @@ struct Arch : BaseCtx
     NetInfo *getConflictingWireNet(WireId wire) const
     {
         NPNR_ASSERT(wire != WireId());
-        if (wire_to_net.find(wire) == wire_to_net.end())
-            return nullptr;
-        else
-            return wire_to_net.at(wire);
+        return wire_state[getWireFlatIndex(wire)].bound_net;
     }
 
     DelayInfo getWireDelay(WireId wire) const
@@ -729,19 +790,20 @@ struct Arch : BaseCtx
 
     uint32_t getPipChecksum(PipId pip) const { return pip.index; }
 
+    int getPipFlatIndex(PipId pip) const
+    {
+        return tile_pip_offset[pip.location.y * chip_info->width + pip.location.x] + pip.index;
+    }
+
     void bindPip(PipId pip, NetInfo *net, PlaceStrength strength)
     {
         NPNR_ASSERT(pip != PipId());
-        NPNR_ASSERT(pip_to_net[pip] == nullptr);
-
-        pip_to_net[pip] = net;
-        wire_fanout[getPipSrcWire(pip)]++;
-
-        WireId dst;
-        dst.index = locInfo(pip)->pip_data[pip.index].dst_idx;
-        dst.location = pip.location + locInfo(pip)->pip_data[pip.index].rel_dst_loc;
-        NPNR_ASSERT(wire_to_net[dst] == nullptr);
-        wire_to_net[dst] = net;
+        WireId dst = getPipDstWire(pip);
+        auto &ws = wire_state[getWireFlatIndex(dst)];
+        NPNR_ASSERT(ws.bound_net == nullptr);
+        ws.bound_net = net;
+        ws.bound_pip = getPipFlatIndex(pip);
+        wire_state[getWireFlatIndex(getPipSrcWire(pip))].fanout++;
         net->wires[dst].pip = pip;
         net->wires[dst].strength = strength;
     }
@@ -749,44 +811,27 @@ struct Arch : BaseCtx
     void unbindPip(PipId pip)
     {
         NPNR_ASSERT(pip != PipId());
-        NPNR_ASSERT(pip_to_net[pip] != nullptr);
-        wire_fanout[getPipSrcWire(pip)]--;
-
-        WireId dst;
-        dst.index = locInfo(pip)->pip_data[pip.index].dst_idx;
-        dst.location = pip.location + locInfo(pip)->pip_data[pip.index].rel_dst_loc;
-        NPNR_ASSERT(wire_to_net[dst] != nullptr);
-        wire_to_net[dst] = nullptr;
-        pip_to_net[pip]->wires.erase(dst);
-
-        pip_to_net[pip] = nullptr;
+        WireId dst = getPipDstWire(pip);
+        auto &ws = wire_state[getWireFlatIndex(dst)];
+        NPNR_ASSERT(ws.bound_net != nullptr && ws.bound_pip == getPipFlatIndex(pip));
+        wire_state[getWireFlatIndex(getPipSrcWire(pip))].fanout--;
+        ws.bound_net->wires.erase(dst);
+        ws.bound_net = nullptr;
+        ws.bound_pip = -1;
     }
 
-    bool checkPipAvail(PipId pip) const
-    {
-        NPNR_ASSERT(pip != PipId());
-        return pip_to_net.find(pip) == pip_to_net.end() || pip_to_net.at(pip) == nullptr;
-    }
+    bool checkPipAvail(PipId pip) const { return getBoundPipNet(pip) == nullptr; }
 
     NetInfo *getBoundPipNet(PipId pip) const
     {
         NPNR_ASSERT(pip != PipId());
-        if (pip_to_net.find(pip) == pip_to_net.end())
-            return nullptr;
-        else
-            return pip_to_net.at(pip);
+        const auto &ws = wire_state[getWireFlatIndex(getPipDstWire(pip))];
+        return ws.bound_pip == getPipFlatIndex(pip) ? ws.bound_net : nullptr;
     }
 
     WireId getConflictingPipWire(PipId pip) const { return WireId(); }
 
-    NetInfo *getConflictingPipNet(PipId pip) const
-    {
-        NPNR_ASSERT(pip != PipId());
-        if (pip_to_net.find(pip) == pip_to_net.end())
-            return nullptr;
-        else
-            return pip_to_net.at(pip);
-    }
+    NetInfo *getConflictingPipNet(PipId pip) const { return getBoundPipNet(pip); }
 
     AllPipRange getPips() const
     {
@@ -823,10 +868,7 @@ struct Arch : BaseCtx
     {
         DelayInfo delay;
         NPNR_ASSERT(pip != PipId());
-        int fanout = 0;
-        auto fnd_fanout = wire_fanout.find(getPipSrcWire(pip));
-        if (fnd_fanout != wire_fanout.end())
-            fanout = fnd_fanout->second;
+        int fanout = wire_state[getWireFlatIndex(getPipSrcWire(pip))].fanout;
         NPNR_ASSERT(locInfo(pip)->pip_data[pip.index].timing_class < speed_grade->num_pip_classes);
         delay.min_delay =
                 speed_grade->pip_classes[locInfo(pip)->pip_data[pip.index].timing_class].min_base_delay +
@@ -968,6 +1010,8 @@ struct Arch : BaseCtx
 
     // Helper function for above
     bool slicesCompatible(const std::vector<const CellInfo *> &cells) const;
+    void bindSliceState(BelId bel, const CellInfo *cell);
+    void unbindSliceState(BelId bel, const CellInfo *cell);
 
     void assignArchInfo();
 
@@ -66,20 +66,60 @@ bool Arch::slicesCompatible(const std::vector<const CellInfo *> &cells) const
     return true;
 }
 
+static bool sameControlSet(const Arch::TileSliceState &ts, const CellInfo *cell)
+{
+    return cell->sliceInfo.clk_sig == ts.clk_sig && cell->sliceInfo.lsr_sig == ts.lsr_sig &&
+           cell->sliceInfo.clkmux == ts.clkmux && cell->sliceInfo.lsrmux == ts.lsrmux &&
+           cell->sliceInfo.srmode == ts.srmode;
+}
+
+void Arch::bindSliceState(BelId bel, const CellInfo *cell)
+{
+    if (!cell->sliceInfo.using_dff)
+        return;
+    auto &ts = tile_slice_state[bel.location.y * chip_info->width + bel.location.x];
+    if (ts.ref_count == 0 && ts.conflicts == 0) {
+        ts.clk_sig = cell->sliceInfo.clk_sig;
+        ts.lsr_sig = cell->sliceInfo.lsr_sig;
+        ts.clkmux = cell->sliceInfo.clkmux;
+        ts.lsrmux = cell->sliceInfo.lsrmux;
+        ts.srmode = cell->sliceInfo.srmode;
+        ts.ref_count = 1;
+    } else if (sameControlSet(ts, cell)) {
+        ts.ref_count++;
+    } else {
+        ts.conflicts++;
+    }
+}
+
+void Arch::unbindSliceState(BelId bel, const CellInfo *cell)
+{
+    if (!cell->sliceInfo.using_dff)
+        return;
+    auto &ts = tile_slice_state[bel.location.y * chip_info->width + bel.location.x];
+    if (ts.ref_count > 0 && sameControlSet(ts, cell))
+        ts.ref_count--;
+    else
+        ts.conflicts--;
+    NPNR_ASSERT(ts.ref_count >= 0 && ts.conflicts >= 0);
+    if (ts.ref_count == 0 && ts.conflicts > 0) {
+        // The last cell using the shared control set has gone, so start again from the remaining cells
+        ts = TileSliceState();
+        for (auto bel_other : getBelsByTile(bel.location.x, bel.location.y)) {
+            CellInfo *cell_other = getBoundBelCell(bel_other);
+            if (cell_other != nullptr && cell_other->type == id_TRELLIS_SLICE)
+                bindSliceState(bel_other, cell_other);
+        }
+    }
+}
+
 bool Arch::isBelLocationValid(BelId bel) const
 {
     if (getBelType(bel) == id_TRELLIS_SLICE) {
-        std::vector<const CellInfo *> bel_cells;
         Loc bel_loc = getBelLocation(bel);
-        for (auto bel_other : getBelsByTile(bel_loc.x, bel_loc.y)) {
-            CellInfo *cell_other = getBoundBelCell(bel_other);
-            if (cell_other != nullptr) {
-                bel_cells.push_back(cell_other);
-            }
-        }
         if (getBoundBelCell(bel) != nullptr && getBoundBelCell(bel)->sliceInfo.has_l6mux && ((bel_loc.z % 2) == 1))
             return false;
-        return slicesCompatible(bel_cells);
+        return tile_slice_state[bel_loc.y * chip_info->width + bel_loc.x].conflicts == 0;
     } else {
         CellInfo *cell = getBoundBelCell(bel);
         if (cell == nullptr)
@@ -100,6 +140,16 @@ bool Arch::isValidBelForCell(CellInfo *cell, BelId bel) const
         if (cell->sliceInfo.has_l6mux && ((bel_loc.z % 2) == 1))
             return false;
 
+        // Unless a different flip-flop cell would have to be taken out of the tile state first, the cached
+        // control set gives the answer directly
+        const CellInfo *bound = getBoundBelCell(bel);
+        if (bound == nullptr || bound == cell || !bound->sliceInfo.using_dff) {
+            const auto &ts = tile_slice_state[bel_loc.y * chip_info->width + bel_loc.x];
+            if (ts.conflicts != 0)
+                return false;
+            return !cell->sliceInfo.using_dff || ts.ref_count == 0 || sameControlSet(ts, cell);
+        }
+
         for (auto bel_other : getBelsByTile(bel_loc.x, bel_loc.y)) {
             CellInfo *cell_other = getBoundBelCell(bel_other);
             if (cell_other != nullptr && bel_other != bel) {
@@ -44,14 +44,8 @@ std::unique_ptr<CellInfo> create_ecp5_cell(Context *ctx, IdString type, std::str
 
     auto copy_bel_ports = [&]() {
         // First find a Bel of the target type
-        BelId tgt;
-        for (auto bel : ctx->getBels()) {
-            if (ctx->getBelType(bel) == type) {
-                tgt = bel;
-                break;
-            }
-        }
-        NPNR_ASSERT(tgt != BelId());
+        NPNR_ASSERT(!ctx->getBelsByType(type).empty());
+        BelId tgt = ctx->getBelsByType(type).front();
         for (auto port : ctx->getBelPins(tgt)) {
             add_port(ctx, new_cell.get(), port.str(ctx), ctx->getBelPinType(tgt, port));
         }
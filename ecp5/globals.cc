@@ -51,6 +51,12 @@ class Ecp5GlobalRouter
     Ecp5GlobalRouter(Context *ctx) : ctx(ctx){};
 
   private:
+    // Uphill pips from a sink pin wire to the global wire feeding it, located relative to the pin wire
+    struct BranchTemplate
+    {
+        std::vector<std::pair<Location, int32_t>> pips;
+    };
+
     bool is_clock_port(const PortRef &user)
     {
         if (user.cell->type == id_TRELLIS_SLICE && (user.port == id_CLK || user.port == id_WCK))
@@ -93,6 +99,9 @@ class Ecp5GlobalRouter
 
     PipId find_tap_pip(WireId tile_glb)
     {
+        auto fnd = tap_pips.find(tile_glb);
+        if (fnd != tap_pips.end())
+            return fnd->second;
         std::string wireName = ctx->getWireBasename(tile_glb).str(ctx);
         std::string glbName = wireName.substr(2);
         TapDirection td = ctx->globalInfoAtLoc(tile_glb.location).tap_dir;
@@ -106,29 +115,94 @@ class Ecp5GlobalRouter
             tap_wire = ctx->getWireByLocAndBasename(tap_loc, "R_" + glbName);
         }
         NPNR_ASSERT(tap_wire != WireId());
-        return *(ctx->getPipsUphill(tap_wire).begin());
+        PipId tap_pip = *(ctx->getPipsUphill(tap_wire).begin());
+        tap_pips[tile_glb] = tap_pip;
+        return tap_pip;
     }
 
     PipId find_spine_pip(WireId tap_wire)
     {
+        auto fnd = spine_pips.find(tap_wire);
+        if (fnd != spine_pips.end())
+            return fnd->second;
         std::string wireName = ctx->getWireBasename(tap_wire).str(ctx);
         Location spine_loc;
         spine_loc.x = ctx->globalInfoAtLoc(tap_wire.location).spine_col;
         spine_loc.y = ctx->globalInfoAtLoc(tap_wire.location).spine_row;
         WireId spine_wire = ctx->getWireByLocAndBasename(spine_loc, wireName);
-        return *(ctx->getPipsUphill(spine_wire).begin());
+        PipId spine_pip = *(ctx->getPipsUphill(spine_wire).begin());
+        spine_pips[tap_wire] = spine_pip;
+        return spine_pip;
     }
 
-    void route_logic_tile_global(NetInfo *net, int global_index, PortRef user)
+    void start_search()
+    {
+        if (wire_epoch.empty()) {
+            wire_backtrace.resize(ctx->getWireFlatIndexCount());
+            wire_epoch.resize(ctx->getWireFlatIndexCount());
+        }
+        if (++search_epoch == 0) {
+            std::fill(wire_epoch.begin(), wire_epoch.end(), 0);
+            search_epoch = 1;
+        }
+    }
+
+    bool has_backtrace(WireId wire) const { return wire_epoch[ctx->getWireFlatIndex(wire)] == search_epoch; }
+
+    PipId get_backtrace(WireId wire) const
+    {
+        int idx = ctx->getWireFlatIndex(wire);
+        return wire_epoch[idx] == search_epoch ? wire_backtrace[idx] : PipId();
+    }
+
+    void set_backtrace(WireId wire, PipId pip)
+    {
+        int idx = ctx->getWireFlatIndex(wire);
+        wire_backtrace[idx] = pip;
+        wire_epoch[idx] = search_epoch;
+    }
+
+    // Follow a cached branch template up from the sink pin wire. On success, pips holds the pips to bind, from the
+    // pin upwards, and top is the global wire or the first wire already used by the net
+    bool apply_branch_template(NetInfo *net, const BranchTemplate &tmpl, IdString global_name, WireId userWire,
+                               std::vector<PipId> &pips, WireId &top, bool &already_routed)
+    {
+        pips.clear();
+        WireId cursor = userWire;
+        for (auto &entry : tmpl.pips) {
+            NetInfo *bound = ctx->getBoundWireNet(cursor);
+            if (bound == net) {
+                top = cursor;
+                already_routed = true;
+                return true;
+            }
+            if (bound != nullptr)
+                return false;
+            PipId pip;
+            pip.location.x = userWire.location.x + entry.first.x;
+            pip.location.y = userWire.location.y + entry.first.y;
+            pip.index = entry.second;
+            if (pip.location.x < 0 || pip.location.y < 0 || pip.location.x >= ctx->chip_info->width ||
+                pip.location.y >= ctx->chip_info->height)
+                return false;
+            const LocationTypePOD *loc = ctx->locInfo(pip);
+            if (pip.index >= loc->num_pips || ctx->getPipDstWire(pip) != cursor)
+                return false;
+            pips.push_back(pip);
+            cursor = ctx->getPipSrcWire(pip);
+        }
+        top = cursor;
+        already_routed = ctx->getBoundWireNet(cursor) == net;
+        return already_routed || ctx->getWireBasename(cursor) == global_name;
+    }
+
+    // Search back from the sink pin wire to the global network, returning the pips found from the pin upwards
+    void search_branch(NetInfo *net, int global_index, IdString global_name, const PortRef &user, WireId userWire,
+                       std::vector<PipId> &pips, WireId &next, bool &already_routed)
     {
-        WireId userWire = ctx->getBelPinWire(user.cell->bel, user.port);
-        WireId globalWire;
-        IdString global_name = ctx->id(fmt_str("G_HPBX" << std::setw(2) << std::setfill('0') << global_index << "00"));
         std::queue<WireId> upstream;
-        std::unordered_map<WireId, PipId> backtrace;
+        start_search();
         upstream.push(userWire);
-        bool already_routed = false;
-        WireId next;
         // Search back from the pin until we reach the global network
         while (true) {
             next = upstream.front();
@@ -136,18 +210,15 @@ class Ecp5GlobalRouter
 
             if (ctx->getBoundWireNet(next) == net) {
                 already_routed = true;
-                globalWire = next;
                 break;
             }
 
-            if (ctx->getWireBasename(next) == global_name) {
-                globalWire = next;
+            if (ctx->getWireBasename(next) == global_name)
                 break;
-            }
             if (ctx->checkWireAvail(next)) {
                 for (auto pip : ctx->getPipsUphill(next)) {
                     WireId src = ctx->getPipSrcWire(pip);
-                    backtrace[src] = pip;
+                    set_backtrace(src, pip);
                     upstream.push(src);
                 }
             }
@@ -156,15 +227,50 @@ class Ecp5GlobalRouter
                           ctx->getBelName(user.cell->bel).c_str(ctx), user.port.c_str(ctx));
             }
         }
-        // Set all the pips we found along the way
+        pips.clear();
         WireId cursor = next;
-        while (true) {
-            auto fnd = backtrace.find(cursor);
-            if (fnd == backtrace.end())
+        while (cursor != userWire) {
+            PipId pip = get_backtrace(cursor);
+            if (pip == PipId())
                 break;
-            ctx->bindPip(fnd->second, net, STRENGTH_LOCKED);
-            cursor = ctx->getPipDstWire(fnd->second);
+            pips.push_back(pip);
+            cursor = ctx->getPipDstWire(pip);
+        }
+        std::reverse(pips.begin(), pips.end());
+    }
+
+    void route_logic_tile_global(NetInfo *net, int global_index, PortRef user)
+    {
+        WireId userWire = ctx->getBelPinWire(user.cell->bel, user.port);
+        IdString global_name = ctx->id(fmt_str("G_HPBX" << std::setw(2) << std::setfill('0') << global_index << "00"));
+        int tile = userWire.location.y * ctx->chip_info->width + userWire.location.x;
+        int loc_type = ctx->chip_info->location_type[tile];
+        uint64_t tmpl_key = (uint64_t(loc_type) << 36) | (uint64_t(userWire.index) << 4) | uint64_t(global_index);
+        std::vector<PipId> pips;
+        WireId next;
+        bool already_routed = false;
+
+        auto fnd_tmpl = branch_templates.find(tmpl_key);
+        if (fnd_tmpl != branch_templates.end() &&
+            apply_branch_template(net, fnd_tmpl->second, global_name, userWire, pips, next, already_routed)) {
+            template_sinks++;
+        } else {
+            search_branch(net, global_index, global_name, user, userWire, pips, next, already_routed);
+            // Only complete branches are useful for other tiles of the same type
+            if (!already_routed) {
+                BranchTemplate &tmpl = branch_templates[tmpl_key];
+                tmpl.pips.clear();
+                for (auto pip : pips) {
+                    Location rel(pip.location.x - userWire.location.x, pip.location.y - userWire.location.y);
+                    tmpl.pips.emplace_back(rel, pip.index);
+                }
+            }
         }
+        routed_sinks++;
+
+        // Set all the pips we found along the way
+        for (auto pip : pips)
+            ctx->bindPip(pip, net, STRENGTH_LOCKED);
         // If the global network inside the tile isn't already set up,
         // we also need to bind the buffers along the way
         if (!already_routed) {
@@ -206,7 +312,7 @@ class Ecp5GlobalRouter
     bool simple_router(NetInfo *net, WireId src, WireId dst, bool allow_fail = false)
     {
         std::queue<WireId> visit;
-        std::unordered_map<WireId, PipId> backtrace;
+        start_search();
         visit.push(src);
         WireId cursor;
         while (true) {
@@ -228,23 +334,23 @@ class Ecp5GlobalRouter
                 break;
             for (auto dh : ctx->getPipsDownhill(cursor)) {
                 WireId pipDst = ctx->getPipDstWire(dh);
-                if (backtrace.count(pipDst))
+                if (has_backtrace(pipDst))
                     continue;
-                backtrace[pipDst] = dh;
+                set_backtrace(pipDst, dh);
                 visit.push(pipDst);
             }
         }
         while (true) {
-            auto fnd = backtrace.find(cursor);
-            if (fnd == backtrace.end())
+            PipId pip = get_backtrace(cursor);
+            if (pip == PipId())
                 break;
             NetInfo *bound = ctx->getBoundWireNet(cursor);
             if (bound != nullptr) {
                 NPNR_ASSERT(bound == net);
                 break;
             }
-            ctx->bindPip(fnd->second, net, STRENGTH_LOCKED);
-            cursor = ctx->getPipSrcWire(fnd->second);
+            ctx->bindPip(pip, net, STRENGTH_LOCKED);
+            cursor = ctx->getPipSrcWire(pip);
         }
         if (ctx->getBoundWireNet(src) == nullptr)
             ctx->bindWire(src, net, STRENGTH_LOCKED);
@@ -278,19 +384,9 @@ class Ecp5GlobalRouter
             drv_bel = ctx->getBelByName(ctx->id(drv.cell->attrs.at(ctx->id("BEL"))));
         } else {
             // Check if driver is a singleton
-            BelId last_bel;
-            bool singleton = true;
-            for (auto bel : ctx->getBels()) {
-                if (ctx->getBelType(bel) == drv.cell->type) {
-                    if (last_bel != BelId()) {
-                        singleton = false;
-                        break;
-                    }
-                    last_bel = bel;
-                }
-            }
-            if (singleton && last_bel != BelId()) {
-                drv_bel = last_bel;
+            const auto &drv_type_bels = ctx->getBelsByType(drv.cell->type);
+            if (drv_type_bels.size() == 1) {
+                drv_bel = drv_type_bels.front();
             }
         }
         if (drv_bel == BelId()) {
@@ -311,12 +407,13 @@ class Ecp5GlobalRouter
         }
     }
 
-    // Return true if a short (<5) route exists between two wires
+    // Return true if a short (<thresh pips) route exists between two wires
     bool has_short_route(WireId src, WireId dst, int thresh = 7)
     {
-        std::queue<WireId> visit;
-        std::unordered_map<WireId, PipId> backtrace;
-        visit.push(src);
+        // The search is breadth first, so wires are queued with their distance and nothing beyond thresh is expanded
+        std::queue<std::pair<WireId, int>> visit;
+        start_search();
+        visit.emplace(src, 0);
         WireId cursor;
         while (true) {
 
@@ -325,30 +422,25 @@ class Ecp5GlobalRouter
                 // ctx->getWireName(dst).c_str(ctx));
                 return false;
             }
-            cursor = visit.front();
+            cursor = visit.front().first;
+            int length = visit.front().second;
             visit.pop();
 
-            if (cursor == dst)
-                break;
+            if (cursor == dst) {
+                // log_info ("dist %s -> %s = %d\n", ctx->getWireName(src).c_str(ctx),
+                // ctx->getWireName(dst).c_str(ctx), length);
+                return length < thresh;
+            }
+            if (length + 1 >= thresh)
+                continue;
             for (auto dh : ctx->getPipsDownhill(cursor)) {
                 WireId pipDst = ctx->getPipDstWire(dh);
-                if (backtrace.count(pipDst))
+                if (has_backtrace(pipDst))
                     continue;
-                backtrace[pipDst] = dh;
-                visit.push(pipDst);
+                set_backtrace(pipDst, dh);
+                visit.emplace(pipDst, length + 1);
             }
         }
-        int length = 0;
-        while (true) {
-            auto fnd = backtrace.find(cursor);
-            if (fnd == backtrace.end())
-                break;
-            cursor = ctx->getPipSrcWire(fnd->second);
-            length++;
-        }
-        // log_info ("dist %s -> %s = %d\n", ctx->getWireName(src).c_str(ctx), ctx->getWireName(dst).c_str(ctx),
-        // length);
-        return length < thresh;
     }
 
     // Attempt to place a DCC
@@ -356,8 +448,8 @@ class Ecp5GlobalRouter
     {
         BelId best_bel;
         wirelen_t best_wirelen = 9999999;
-        for (auto bel : ctx->getBels()) {
-            if (ctx->getBelType(bel) == id_DCCA && ctx->checkBelAvail(bel)) {
+        for (auto bel : ctx->getBelsByType(id_DCCA)) {
+            if (ctx->checkBelAvail(bel)) {
                 if (ctx->isValidBelForCell(dcc, bel)) {
                     ctx->bindBel(bel, dcc, STRENGTH_LOCKED);
                     wirelen_t wirelen = get_dcc_wirelen(dcc);
@@ -428,6 +520,16 @@ class Ecp5GlobalRouter
 
     Context *ctx;
 
+    // Keyed by the location type of the sink tile, the pin wire index and the global network
+    std::unordered_map<uint64_t, BranchTemplate> branch_templates;
+    int routed_sinks = 0, template_sinks = 0;
+    std::unordered_map<WireId, PipId> tap_pips, spine_pips;
+
+    // Search backtrace indexed by ctx->getWireFlatIndex, entries are only valid if their epoch matches search_epoch
+    std::vector<PipId> wire_backtrace;
+    std::vector<uint32_t> wire_epoch;
+    uint32_t search_epoch = 0;
+
   public:
     void promote_globals()
     {
@@ -486,6 +588,9 @@ class Ecp5GlobalRouter
         for (const auto &user : toroute) {
             route_logic_tile_global(clocks.at(user.second), user.second, *user.first);
         }
+        if (routed_sinks > 0)
+            log_info("    routed %d clock sinks, %d of them using %d branch templates\n", routed_sinks, template_sinks,
+                     int(branch_templates.size()));
     }
 };
 void promote_ecp5_globals(Context *ctx) { Ecp5GlobalRouter(ctx).promote_globals(); }
@@ -103,6 +103,11 @@ bool Arch::applyLPF(std::string filename, std::istream &in)
                         auto fnd_cell = cells.find(id(cell));
                         if (fnd_cell != cells.end()) {
                             fnd_cell->second->attrs[id("LOC")] = strip_quotes(words.at(4));
+                        } else if (cells.count(id(cell + "$tr_io"))) {
+                            // The design is already packed and placed (loaded from a checkpoint)
+                            log_warning("ignoring LOCATE for port '%s' in a placed design, changing pin locations "
+                                        "needs place and route (on line %d)\n",
+                                        cell.c_str(), lineno);
                         }
                     } else if (verb == "IOBUF") {
                         if (words.size() < 3)
@@ -112,6 +117,10 @@ bool Arch::applyLPF(std::string filename, std::istream &in)
                             log_error("expected 'PORT' after 'IOBUF' (on line %d)\n", lineno);
                         std::string cell = strip_quotes(words.at(2));
                         auto fnd_cell = cells.find(id(cell));
+                        // In a packed design, such as one loaded from a checkpoint, the attributes belong on the
+                        // TRELLIS_IO cell created for the port
+                        if (fnd_cell == cells.end())
+                            fnd_cell = cells.find(id(cell + "$tr_io"));
                         if (fnd_cell != cells.end()) {
                             for (size_t i = 3; i < words.size(); i++) {
                                 std::string setting = words.at(i);
@@ -1339,14 +1339,8 @@ class Ecp5Packer
                 if (!ci->attrs.count(ctx->id("BEL")))
                     log_error("DCU must be constrained to a Bel!\n");
                 // Empty port auto-creation to generate correct tie-downs
-                BelId exemplar_bel;
-                for (auto bel : ctx->getBels()) {
-                    if (ctx->getBelType(bel) == id_DCUA) {
-                        exemplar_bel = bel;
-                        break;
-                    }
-                }
-                NPNR_ASSERT(exemplar_bel != BelId());
+                NPNR_ASSERT(!ctx->getBelsByType(id_DCUA).empty());
+                BelId exemplar_bel = ctx->getBelsByType(id_DCUA).front();
                 for (auto pin : ctx->getBelPins(exemplar_bel))
                     if (ctx->getBelPinType(exemplar_bel, pin) == PORT_IN)
                         autocreate_empty_port(ci, pin);
@@ -1394,8 +1388,8 @@ class Ecp5Packer
     void preplace_plls()
     {
         std::set<BelId> available_plls;
-        for (auto bel : ctx->getBels()) {
-            if (ctx->getBelType(bel) == id_EHXPLLL && ctx->checkBelAvail(bel))
+        for (auto bel : ctx->getBelsByType(id_EHXPLLL)) {
+            if (ctx->checkBelAvail(bel))
                 available_plls.insert(bel);
         }
         for (auto cell : sorted(ctx->cells)) {
@@ -1506,9 +1500,7 @@ class Ecp5Packer
                 BelId target_bel;
                 // Find the correct Bel for the ECLKBUF
                 IdString eclkname = ctx->id("G_BANK" + std::to_string(bank) + "ECLK" + std::to_string(free_eclk));
-                for (auto bel : ctx->getBels()) {
-                    if (ctx->getBelType(bel) != id_TRELLIS_ECLKBUF)
-                        continue;
+                for (auto bel : ctx->getBelsByType(id_TRELLIS_ECLKBUF)) {
                     if (ctx->getWireBasename(ctx->getBelPinWire(bel, id_ECLKO)) != eclkname)
                         continue;
                     target_bel = bel;
@@ -2146,9 +2138,7 @@ class Ecp5Packer
                 const NetInfo *clki = net_or_nullptr(ci, id_CLKI);
                 for (auto &eclk : eclks) {
                     if (eclk.second.unbuf == clki) {
-                        for (auto bel : ctx->getBels()) {
-                            if (ctx->getBelType(bel) != id_CLKDIVF)
-                                continue;
+                        for (auto bel : ctx->getBelsByType(id_CLKDIVF)) {
                             Loc loc = ctx->getBelLocation(bel);
                             // CLKDIVF for bank 6/7 on the left; for bank 2/3 on the right
                             if (loc.x < 10 && eclk.first.first != 6 && eclk.first.first != 7)
@@ -2172,9 +2162,7 @@ class Ecp5Packer
                     if (user.cell->type == id_TRELLIS_ECLKBUF) {
                         Loc eckbuf_loc =
                                 ctx->getBelLocation(ctx->getBelByName(ctx->id(user.cell->attrs.at(ctx->id("BEL")))));
-                        for (auto bel : ctx->getBels()) {
-                            if (ctx->getBelType(bel) != id_ECLKSYNCB)
-                                continue;
+                        for (auto bel : ctx->getBelsByType(id_ECLKSYNCB)) {
                             Loc loc = ctx->getBelLocation(bel);
                             if (loc.x == eckbuf_loc.x && loc.y == eckbuf_loc.y && loc.z == eckbuf_loc.z - 2) {
                                 ci->attrs[ctx->id("BEL")] = ctx->getBelName(bel).str(ctx);
@@ -2192,9 +2180,7 @@ class Ecp5Packer
                     log_error("DDRDLLA '%s' has disconnected port CLK\n", ci->name.c_str(ctx));
                 for (auto &eclk : eclks) {
                     if (eclk.second.unbuf == clk) {
-                        for (auto bel : ctx->getBels()) {
-                            if (ctx->getBelType(bel) != id_DDRDLL)
-                                continue;
+                        for (auto bel : ctx->getBelsByType(id_DDRDLL)) {
                             Loc loc = ctx->getBelLocation(bel);
                             int ddrdll_bank = -1;
                             if (loc.x < 15 && loc.y < 15)
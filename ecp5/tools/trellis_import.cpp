@@ -29,7 +29,11 @@
 #include <vector>
 #include <regex>
 #include <algorithm>
+#include <chrono>
 #include <typeinfo>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
 
 
 #include <Poco/JSON/Parser.h>
@@ -878,6 +882,221 @@ int get_pip_class(std::string &wire_from, std::string &wire_to) {
 }
 
 
+// Delay lookahead.
+// For each class of wire and each tile offset up to lookahead_range in x and y, the lookahead holds the smallest
+// routed delay from a wire of that class to a bel input wire at that offset, as those are what the router searches
+// for. It is found by running Dijkstra over the routing graph from a few sample wires of each class near the centre
+// of the device. Offsets outside the range are estimated from the clamped offset plus a per-class delay per tile.
+const int lookahead_range = 12;
+const int lookahead_samples = 4;
+// Wires further than this beyond the lookahead range from the sample wire are not expanded.
+const int lookahead_margin = 6;
+const int lookahead_unreachable = 0xFFFF;
+
+std::map<std::string, int> lookahead_classes;
+// Indexed by location type, then by wire or arc index.
+std::vector<std::vector<int> > wire_lookahead_class;
+std::vector<std::vector<int> > arc_timing_class;
+
+struct Lookahead {
+	// Indexed by class, then by (dy + lookahead_range) * (2 * lookahead_range + 1) + dx + lookahead_range.
+	std::vector<std::vector<int> > delays;
+	std::vector<int> delay_per_tile;
+	// Statistics for the import log.
+	int searches = 0;
+	long long visited = 0;
+};
+
+
+// Get the lookahead class of a wire. Wires of the general routing fabric are grouped by their span, direction and
+// segment (eg. H06W0302 -> H06W02); all other wires are grouped by their name with any digits removed.
+int get_lookahead_class(std::string name) {
+	static const std::regex span_re("^([HV][0-9]{2}[NSEWLR])[0-9]{2}([0-9]{2})$");
+	static const std::regex digit_re("[0-9]");
+	
+	std::smatch m;
+	std::string class_name;
+	if (std::regex_match(name, m, span_re)) {
+		class_name = m[1].str() + m[2].str();
+	}
+	else {
+		class_name = std::regex_replace(name, digit_re, "");
+	}
+	
+	if (lookahead_classes.find(class_name) == lookahead_classes.end()) {
+		int idx = lookahead_classes.size();
+		lookahead_classes[class_name] = idx;
+	}
+	
+	return lookahead_classes[class_name];
+}
+
+
+Lookahead compute_lookahead(std::shared_ptr<Trellis::DDChipDb::DedupChipdb> ddrg, 
+							const std::vector<int> &tile_loctype, const std::vector<PipClass> &pip_classes) {
+	int width = max_col + 1;
+	int height = max_row + 1;
+	int row_len = 2 * lookahead_range + 1;
+	int num_classes = lookahead_classes.size();
+	
+	Lookahead la;
+	la.delays.resize(num_classes, std::vector<int>(row_len * row_len, lookahead_unreachable));
+	la.delay_per_tile.resize(num_classes, 0);
+	
+	// Visit tiles in order of their distance from the centre of the device, taking the first few wires of each
+	// class that are found as the sample wires.
+	std::vector<std::pair<int, int> > tiles;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			tiles.push_back(std::make_pair(x, y));
+		}
+	}
+	
+	auto centre_dist = [&](const std::pair<int, int> &t) {
+		return std::max(std::abs(t.first - width / 2), std::abs(t.second - height / 2));
+	};
+	
+	std::stable_sort(tiles.begin(), tiles.end(), 
+					[&](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+		return centre_dist(a) < centre_dist(b);
+	});
+	
+	std::vector<std::vector<std::tuple<int, int, int> > > samples(num_classes);
+	for (std::pair<int, int> tile : tiles) {
+		int lt = tile_loctype[tile.second * width + tile.first];
+		if (lt < 0) { continue; }
+		for (int wire_idx = 0; wire_idx < wire_lookahead_class[lt].size(); ++wire_idx) {
+			int cls = wire_lookahead_class[lt][wire_idx];
+			if (samples[cls].size() < lookahead_samples) {
+				samples[cls].push_back(std::make_tuple(tile.first, tile.second, wire_idx));
+			}
+		}
+	}
+	
+	// Search state lives in flat arrays covering the window of tiles a search may reach, indexed by
+	// (tile in window) * max_wires + wire index. Entries are valid if their stamp matches the current search.
+	std::vector<const Trellis::DDChipDb::LocationData *> tile_data(width * height, nullptr);
+	int max_wires = 0;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (tile_loctype[y * width + x] < 0) { continue; }
+			const Trellis::DDChipDb::LocationData &ld = 
+										(*ddrg).locationTypes[(*ddrg).typeAtLocation[Trellis::Location(x, y)]];
+			tile_data[y * width + x] = &ld;
+			max_wires = std::max(max_wires, int(ld.wires.size()));
+		}
+	}
+	
+	// Wires driving a bel input are the destinations the router searches for.
+	std::vector<std::vector<bool> > is_sink(width * height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (tile_data[y * width + x] == nullptr) { continue; }
+			is_sink[y * width + x].resize(tile_data[y * width + x]->wires.size(), false);
+		}
+	}
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (tile_data[y * width + x] == nullptr) { continue; }
+			for (const Trellis::DDChipDb::BelData &bel : tile_data[y * width + x]->bels) {
+				for (const Trellis::DDChipDb::BelWire &pin : bel.wires) {
+					if (pin.dir == Trellis::PORT_OUT) { continue; }
+					int wx = x + pin.wire.rel.x;
+					int wy = y + pin.wire.rel.y;
+					if (wx < 0 || wx >= width || wy < 0 || wy >= height || is_sink[wy * width + wx].empty()) { continue; }
+					is_sink[wy * width + wx][pin.wire.id] = true;
+				}
+			}
+		}
+	}
+	
+	int window_radius = lookahead_range + lookahead_margin;
+	int window_len = 2 * window_radius + 1;
+	std::vector<int> best(size_t(window_len) * window_len * max_wires);
+	std::vector<uint32_t> stamp(best.size(), 0);
+	uint32_t search_stamp = 0;
+	
+	typedef std::tuple<int, int, int, int> QueueEntry; // delay, x, y, wire index
+	
+	for (int cls = 0; cls < num_classes; ++cls) {
+		for (std::tuple<int, int, int> sample : samples[cls]) {
+			int sx = std::get<0>(sample);
+			int sy = std::get<1>(sample);
+			int sidx = std::get<2>(sample);
+			
+			auto slot = [&](int x, int y, int idx) {
+				return (size_t(y - sy + window_radius) * window_len + (x - sx + window_radius)) * max_wires + idx;
+			};
+			
+			++search_stamp;
+			++la.searches;
+			std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > queue;
+			queue.push(std::make_tuple(0, sx, sy, sidx));
+			best[slot(sx, sy, sidx)] = 0;
+			stamp[slot(sx, sy, sidx)] = search_stamp;
+			
+			while (!queue.empty()) {
+				int delay, x, y, idx;
+				std::tie(delay, x, y, idx) = queue.top();
+				queue.pop();
+				if (best[slot(x, y, idx)] < delay) { continue; }
+				++la.visited;
+				
+				const Trellis::DDChipDb::WireData &wire = tile_data[y * width + x]->wires[idx];
+				
+				// Only bel inputs reached through at least one pip are destinations of the router.
+				int dx = x - sx;
+				int dy = y - sy;
+				bool is_start = (dx == 0 && dy == 0 && idx == sidx);
+				if (!is_start && is_sink[y * width + x][idx] && 
+					std::abs(dx) <= lookahead_range && std::abs(dy) <= lookahead_range) {
+					int &entry = la.delays[cls][(dy + lookahead_range) * row_len + dx + lookahead_range];
+					entry = std::min(entry, delay);
+				}
+				
+				for (Trellis::DDChipDb::RelId dp : wire.arcsDownhill) {
+					int px = x + dp.rel.x;
+					int py = y + dp.rel.y;
+					int plt = tile_loctype[py * width + px];
+					const Trellis::DDChipDb::DdArcData &arc = tile_data[py * width + px]->arcs[dp.id];
+					int nx = px + arc.sinkWire.rel.x;
+					int ny = py + arc.sinkWire.rel.y;
+					if (std::abs(nx - sx) > window_radius || std::abs(ny - sy) > window_radius) {
+						continue;
+					}
+					
+					int next_delay = delay + pip_classes[arc_timing_class[plt][dp.id]].max_delay;
+					size_t next = slot(nx, ny, arc.sinkWire.id);
+					if (stamp[next] == search_stamp && best[next] <= next_delay) { continue; }
+					stamp[next] = search_stamp;
+					best[next] = next_delay;
+					queue.push(std::make_tuple(next_delay, nx, ny, arc.sinkWire.id));
+				}
+			}
+		}
+		
+		// The delay per tile beyond the range is the smallest average delay per tile to the edge of the table.
+		int per_tile = -1;
+		for (int dy = -lookahead_range; dy <= lookahead_range; ++dy) {
+			for (int dx = -lookahead_range; dx <= lookahead_range; ++dx) {
+				if (std::max(std::abs(dx), std::abs(dy)) != lookahead_range) { continue; }
+				int entry = la.delays[cls][(dy + lookahead_range) * row_len + dx + lookahead_range];
+				if (entry == lookahead_unreachable) { continue; }
+				int avg = entry / lookahead_range;
+				if (per_tile == -1 || avg < per_tile) { per_tile = avg; }
+			}
+		}
+		
+		la.delay_per_tile[cls] = std::max(per_tile, 0);
+		for (int &entry : la.delays[cls]) {
+			entry = std::min(entry, lookahead_unreachable);
+		}
+	}
+	
+	return la;
+}
+
+
 void write_database(std::string device_name, Trellis::Chip chip, 
 					std::shared_ptr<Trellis::DDChipDb::DedupChipdb> ddrg, std::string endianness) {
 	// For each device a database file is written to disk. 
@@ -921,6 +1140,11 @@ void write_database(std::string device_name, Trellis::Chip chip,
 	// Debug
 	std::cout << "Found " << loctypes.size() << " entries in loctypes vector." << std::endl;
 	
+	wire_lookahead_class.clear();
+	wire_lookahead_class.resize(loctypes.size());
+	arc_timing_class.clear();
+	arc_timing_class.resize(loctypes.size());
+	
     for (int idx = 0; idx < loctypes.size(); ++idx) {		
         Trellis::DDChipDb::LocationData loctype = (*ddrg).locationTypes[loctypes[idx]];
         if (loctype.arcs.size() > 0) {
@@ -932,7 +1156,9 @@ void write_database(std::string device_name, Trellis::Chip chip,
                 bba.u32(arc.sinkWire.id, "dst_idx");
                 std::string src_name = get_wire_name(ddrg, idx, arc.srcWire.rel, arc.srcWire.id);
                 std::string snk_name = get_wire_name(ddrg, idx, arc.sinkWire.rel, arc.sinkWire.id);
-                bba.u32(get_pip_class(src_name, snk_name), "timing_class");
+                int timing_class = get_pip_class(src_name, snk_name);
+                arc_timing_class[idx].push_back(timing_class);
+                bba.u32(timing_class, "timing_class");
                 bba.u16(get_tiletype_index((*ddrg).to_str(arc.tiletype)), "tile_type");
                 Trellis::DDChipDb::ArcClass cls = arc.cls;
 				if (cls == Trellis::DDChipDb::ARC_STANDARD && 
@@ -1010,6 +1236,11 @@ void write_database(std::string device_name, Trellis::Chip chip,
 				else {
 					bba.r("None", "bel_pins");
 				}
+				
+				int lookahead_class = get_lookahead_class((*ddrg).to_str(wire.name));
+				wire_lookahead_class[idx].push_back(lookahead_class);
+                bba.u16(lookahead_class, "lookahead_class");
+                bba.u16(0, "padding");
 			}
 		}
 
@@ -1155,6 +1386,41 @@ void write_database(std::string device_name, Trellis::Chip chip,
         bba.s(tt, "name");
 	}
 
+	std::cout << "Computing delay lookahead..." << std::endl;
+	
+	std::vector<int> tile_loctype((max_col + 1) * (max_row + 1), -1);
+    for (int y = 0; y < max_row + 1; ++y) {
+        for (int x = 0; x < max_col + 1; ++x) {
+			std::ptrdiff_t pos = std::distance(loctypes.begin(), 
+								std::find(loctypes.begin(), loctypes.end(), 
+								(*ddrg).typeAtLocation[Trellis::Location(x, y)]));
+			if (pos < loctypes.size()) {
+				tile_loctype[y * (max_col + 1) + x] = pos;
+			}
+		}
+	}
+	
+    for (std::string grade : speed_grade_names) {
+		auto la_start = std::chrono::steady_clock::now();
+		Lookahead la = compute_lookahead(ddrg, tile_loctype, chips[grade].pip_class_delays);
+		std::chrono::duration<double> la_time = std::chrono::steady_clock::now() - la_start;
+		std::cout << "Delay lookahead for speed grade " << grade << ": " << la.delays.size() << " classes, " 
+					<< la.searches << " searches, " << la.visited << " wires visited, " 
+					<< la_time.count() << "s." << std::endl;
+		for (int cls = 0; cls < la.delays.size(); ++cls) {
+            bba.l("lookahead_" + grade + "_" + std::to_string(cls), "uint16_t");
+            for (int entry : la.delays[cls]) {
+                bba.u16(entry);
+			}
+		}
+		
+        bba.l("lookahead_classes_" + grade, "LookaheadClassPOD");
+		for (int cls = 0; cls < la.delays.size(); ++cls) {
+            bba.u32(la.delay_per_tile[cls], "delay_per_tile");
+            bba.r("lookahead_" + grade + "_" + std::to_string(cls), "delays");
+		}
+	}
+	
 	std::cout << "Writing speed grades..." << std::endl;
 	
     for (std::string grade : speed_grade_names) {
@@ -1224,6 +1490,9 @@ void write_database(std::string device_name, Trellis::Chip chip,
         bba.u32(chips[grade].pip_class_delays.size(), "num_pip_classes");
         bba.r("cell_timing_data_" + grade, "cell_timings");
         bba.r("pip_timing_data_" + grade, "pip_classes");
+        bba.u32(lookahead_range, "lookahead_range");
+        bba.u32(lookahead_classes.size(), "num_lookahead_classes");
+        bba.r("lookahead_classes_" + grade, "lookahead_classes");
 	}
 	
 	std::cout << "Writing chip info..." << std::endl;